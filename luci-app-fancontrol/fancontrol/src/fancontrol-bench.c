@@ -0,0 +1,605 @@
+/**
+ * fancontrol 基准测试
+ * 直接编译 fancontrol.c 的实现（main 改名），在宿主机上测量各模块的开销，不访问真实的 sysfs
+ *
+ * 用法: fancontrol-bench [controllers|sysfs|ring|subscribers|tsdb]（或 make bench）
+ * 不带参数时运行全部测试
+ */
+#define main fancontrol_main
+#include "fancontrol.c"
+#undef main
+
+// 单调时钟（纳秒）
+static uint64_t bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * 一阶热模型：发热功率固定，散热随风扇输出线性增加
+ * 风扇输出约50%时稳定在55°C，第1800秒发热增加30%（负载阶跃）
+ */
+typedef struct {
+    float temp;     // 当前温度（°C）
+    float heat;     // 发热（°C/秒，折算后）
+} BenchPlant;
+
+#define BENCH_AMBIENT 30.0
+#define BENCH_TAU 60.0
+
+static void bench_plant_step(BenchPlant* p, float output, float dt) {
+    float cooling = (0.2 + 0.8 * output / 100.0) * (p->temp - BENCH_AMBIENT) / BENCH_TAU;
+    p->temp += (p->heat - cooling) * dt;
+}
+
+// 控制器输出统一换算为百分比
+static float bench_controller_output(const Controller* c, float out) {
+    return c->ops->direct_pwm ? out * 100.0 / 255.0 : out;
+}
+
+/**
+ * 闭环运行一个控制器：控制器按 pid_interval 计算（与守护进程相同），热模型按 0.1 秒积分
+ * heat 为前半段的发热，后半段乘以 step；结果为后半段之前和之后的积分绝对误差等
+ */
+#define BENCH_PLANT_DT 0.1
+
+typedef struct {
+    float iae;          // 积分绝对误差（°C·秒）
+    float peak;         // 最大超调（°C）
+    float dip;          // 最大低于设定点的幅度（°C）
+    int changes;        // 输出变化次数
+    int saturated;      // 输出为100%的计算次数
+} BenchRun;
+
+static BenchRun bench_closed_loop(Controller* c, float heat, float step, int sim_time) {
+    BenchRun r = { 0 };
+    c->ops->reset(&c->st);
+    BenchPlant plant = { BENCH_AMBIENT, heat };
+    float out = 0.0, last = -1.0;
+    int ticks = (int)(pid_interval / BENCH_PLANT_DT + 0.5);
+    for (int n = 0; n * BENCH_PLANT_DT < sim_time; n++) {
+        float t = n * BENCH_PLANT_DT;
+        if (n == (int)(sim_time / 2 / BENCH_PLANT_DT)) plant.heat *= step;
+        if (n % ticks == 0) {
+            out = bench_controller_output(c, c->ops->step(&c->st, plant.temp, target_temp, pid_interval));
+            if (out < 0) out = 0;
+            if (out > 100) out = 100;
+            if (out != last) r.changes++;
+            if (out >= 100) r.saturated++;
+            last = out;
+        }
+        bench_plant_step(&plant, out, BENCH_PLANT_DT);
+        float err = plant.temp - target_temp;
+        r.iae += fabsf(err) * BENCH_PLANT_DT;
+        if (err > r.peak) r.peak = err;
+        // 从环境温度启动的升温阶段不计入低于设定点的幅度
+        if (t > sim_time / 2 && -err > r.dip) r.dip = -err;
+    }
+    return r;
+}
+
+/**
+ * 控制器基准测试
+ * 每个注册的控制器单独测量：单步计算耗时、快照/恢复耗时，以及在热模型上的闭环表现
+ * （积分绝对误差、超调、输出变化次数）。nominal 为风扇输出约50%时的负载并在中途增加30%；
+ * saturated 前半段的发热即使全速也压不住（稳定在设定点以上约10°C），后半段回到 nominal，
+ * 检查输出饱和之后能否及时退出全速而不过冷
+ */
+static void bench_controllers(void) {
+    const int steps = 1000000;
+    const int sim_time = 8 * 3600;
+    const float nominal = 0.6 * (55.0 - BENCH_AMBIENT) / BENCH_TAU;
+    const float overload = (target_temp + 10 - BENCH_AMBIENT) / BENCH_TAU;
+
+    // 曲线控制器需要曲线点：45°C停止，65°C全速
+    curve_points = 3;
+    curve_temp[0] = 45; curve_pwm[0] = 0;
+    curve_temp[1] = 55; curve_pwm[1] = 128;
+    curve_temp[2] = 65; curve_pwm[2] = 255;
+    feedforward_total = 0.0;
+
+    printf("controllers (%d steps, %d h closed loop every %d s, setpoint %d°C)\n",
+        steps, sim_time / 3600, pid_interval, target_temp);
+    printf("  %-6s %-9s %10s %12s %10s %10s %8s %8s %9s\n", "name", "load", "ns/step", "snap+restore",
+        "IAE", "overshoot", "dip", "changes", "saturated");
+
+    for (size_t i = 0; i < sizeof(controller_registry) / sizeof(controller_registry[0]); i++) {
+        Controller c = { 0 };
+        controller_select(&c, controller_registry[i]->name);
+
+        // 单步耗时：温度在设定点附近正弦变化，覆盖各分支
+        volatile float sink = 0;
+        uint64_t t0 = bench_ns();
+        for (int n = 0; n < steps; n++) {
+            float temp = target_temp + 8.0 * sinf(n * 0.001);
+            sink += c.ops->step(&c.st, temp, target_temp, pid_interval);
+        }
+        double step_ns = (double)(bench_ns() - t0) / steps;
+
+        unsigned char snap[CONTROLLER_SNAPSHOT_MAX];
+        t0 = bench_ns();
+        for (int n = 0; n < steps; n++) {
+            size_t len = c.ops->snapshot(&c.st, snap, sizeof(snap));
+            c.ops->restore(&c.st, snap, len);
+        }
+        double snap_ns = (double)(bench_ns() - t0) / steps;
+
+        BenchRun r = bench_closed_loop(&c, nominal, 1.3, sim_time);
+        printf("  %-6s %-9s %10.1f %12.1f %10.0f %9.2f° %7.2f° %8d %9d\n",
+            c.ops->name, "nominal", step_ns, snap_ns, r.iae, r.peak, r.dip, r.changes, r.saturated);
+        r = bench_closed_loop(&c, overload, nominal / overload, sim_time);
+        printf("  %-6s %-9s %10s %12s %10.0f %9.2f° %7.2f° %8d %9d\n",
+            "", "saturated", "", "", r.iae, r.peak, r.dip, r.changes, r.saturated);
+        (void)sink;
+    }
+}
+
+/**
+ * PID 饱和恢复检查：温度固定在设定点以上25°C使输出饱和，之后降到设定点以下5°C，
+ * 按不同的计算间隔记录饱和期间积分项的范围，以及降温后输出离开100%所需的计算次数
+ */
+static void bench_pid_saturation(void) {
+    const float intervals[] = { 1, 5, pid_interval, 2 * pid_interval };
+    printf("pid saturation recovery (Kp %.2f Ki %.3f Kd %.2f Kb %.2f, 40 steps at +25°C then -5°C)\n", Kp, Ki, Kd, Kb);
+    printf("  %8s %12s %12s %10s\n", "dt", "integral min", "integral max", "recovery");
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+        float dt = intervals[i];
+        PIDController pid;
+        PID_Init(&pid, Kp, Ki, Kd);
+        float lo = 0, hi = 0;
+        for (int n = 0; n < 40; n++) {
+            PID_Calculate(&pid, target_temp, target_temp + 25, dt);
+            if (pid.integral < lo) lo = pid.integral;
+            if (pid.integral > hi) hi = pid.integral;
+        }
+        int steps = 0;
+        while (steps < 1000 && PID_Calculate(&pid, target_temp, target_temp - 5, dt) >= pid.out_max) steps++;
+        if (isfinite(lo) && isfinite(hi) && steps < 1000)
+            printf("  %7.0fs %12.1f %12.1f %7d st\n", dt, lo, hi, steps + 1);
+        else
+            printf("  %7.0fs %12.1f %12.1f %10s\n", dt, lo, hi, "DIVERGED");
+    }
+}
+
+/**
+ * sysfs批量读写基准测试
+ * 在临时目录中建立假的sysfs属性文件，分别测量 pread/pwrite 和 io_uring 两种方式下
+ * 每个周期的系统调用数和耗时；最后一组有一个属性文件缺失，检查只重新打开该文件
+ */
+static void bench_sysfs_run(const char* dir, int count, int use_uring, int missing) {
+    static char paths[SYSFS_BATCH_MAX][MAX_LENGTH];
+    const char* read_paths[SYSFS_BATCH_MAX];
+    const char* write_paths[SYSFS_BATCH_MAX];
+    int values[SYSFS_BATCH_MAX];
+    static char pwm_paths[SYSFS_BATCH_MAX][MAX_LENGTH];
+    const int cycles = 2000;
+
+    for (int i = 0; i < count; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s/temp%d_input", dir, i + 1);
+        snprintf(pwm_paths[i], sizeof(pwm_paths[i]), "%s/pwm%d", dir, i + 1);
+        if (!(missing && i == count - 1)) {
+            FILE* fp = fopen(paths[i], "w");
+            if (fp) {
+                fprintf(fp, "%d\n", 40000 + i * 125);
+                fclose(fp);
+            }
+            fp = fopen(pwm_paths[i], "w");
+            if (fp) fclose(fp);
+        }
+        read_paths[i] = paths[i];
+        write_paths[i] = pwm_paths[i];
+        values[i] = 128;
+    }
+
+    SysfsBatch rd = { 0 }, wr = { 0 };
+    sysfs_batch_open(&rd, read_paths, count, O_RDONLY, use_uring);
+    sysfs_batch_open(&wr, write_paths, count, O_WRONLY, use_uring);
+    unsigned long rd_open = rd.syscalls, wr_open = wr.syscalls;
+
+    uint64_t t0 = bench_ns();
+    for (int n = 0; n < cycles; n++) sysfs_batch_read(&rd);
+    double read_us = (double)(bench_ns() - t0) / cycles / 1000.0;
+    t0 = bench_ns();
+    for (int n = 0; n < cycles; n++) {
+        values[0] = n & 0xff;
+        sysfs_batch_write(&wr, values);
+    }
+    double write_us = (double)(bench_ns() - t0) / cycles / 1000.0;
+
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        if (rd.len[i] > 0) valid++;
+    }
+    printf("  %3d %-8s %-8s %9.2f %10.2f %9.2f %10.2f %6d/%d\n", count,
+        use_uring && rd.use_uring ? "io_uring" : "pread", missing ? "1 gone" : "-",
+        (double)(rd.syscalls - rd_open) / cycles, read_us,
+        (double)(wr.syscalls - wr_open) / cycles, write_us, valid, count);
+
+    sysfs_batch_close(&rd);
+    sysfs_batch_close(&wr);
+    for (int i = 0; i < count; i++) {
+        unlink(paths[i]);
+        unlink(pwm_paths[i]);
+    }
+}
+
+static void bench_sysfs(void) {
+    static const int counts[] = { 4, 16, 64 };
+    char dir[] = "/tmp/fancontrol-bench.XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return;
+    }
+
+    printf("sysfs batch (fake sysfs in %s, 2000 cycles)\n", dir);
+    printf("  %3s %-8s %-8s %9s %10s %9s %10s %8s\n", "n", "method", "files", "rd sys/c", "rd us/c", "wr sys/c", "wr us/c", "valid");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        bench_sysfs_run(dir, counts[i], 0, 0);
+        bench_sysfs_run(dir, counts[i], 1, 0);
+    }
+    bench_sysfs_run(dir, 16, 0, 1);
+    bench_sysfs_run(dir, 16, 1, 1);
+    rmdir(dir);
+}
+
+/**
+ * 采样环形队列基准测试
+ * 控制线程一侧逐条计时 push，每128条让出一次CPU（控制循环在周期之间休眠），消费者线程同时取出；
+ * 另外可加若干个反复拷贝内存的线程制造缓存和CPU争用。输出延迟分位数和因队列满丢弃的记录数
+ */
+typedef struct {
+    SampleRing* ring;
+    volatile int stop;
+} BenchConsumer;
+
+static void* bench_ring_consumer(void* arg) {
+    BenchConsumer* bc = arg;
+    SampleRecord rec;
+    while (!bc->stop) {
+        if (!sample_ring_pop(bc->ring, &rec)) sched_yield();
+    }
+    while (sample_ring_pop(bc->ring, &rec)) {
+    }
+    return NULL;
+}
+
+static void* bench_ring_noise(void* arg) {
+    BenchConsumer* bc = arg;
+    size_t size = 4 << 20;
+    char* a = malloc(size);
+    char* b = malloc(size);
+    if (a && b) {
+        memset(a, 1, size);
+        while (!bc->stop) memcpy(b, a, size);
+    }
+    free(a);
+    free(b);
+    return NULL;
+}
+
+static int bench_cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_ring_run(const char* name, int consumer, int noise) {
+    const int pushes = 200000;
+    static SampleRing ring;
+    uint32_t* lat = malloc(pushes * sizeof(*lat));
+    if (lat == NULL) return;
+    memset(lat, 0, pushes * sizeof(*lat));
+    memset(&ring, 0, sizeof(ring));
+
+    BenchConsumer bc = { &ring, 0 };
+    pthread_t threads[8];
+    int nthreads = 0;
+    if (consumer) pthread_create(&threads[nthreads++], NULL, bench_ring_consumer, &bc);
+    for (int i = 0; i < noise && nthreads < 8; i++) {
+        pthread_create(&threads[nthreads++], NULL, bench_ring_noise, &bc);
+    }
+
+    SampleRecord rec = { 0 };
+    SampleRecord out;
+    for (int n = 0; n < pushes; n++) {
+        rec.time = n;
+        uint64_t t0 = bench_ns();
+        sample_ring_push(&ring, &rec);
+        lat[n] = (uint32_t)(bench_ns() - t0);
+        if (!consumer) sample_ring_pop(&ring, &out);
+        if ((n & 127) == 127) sched_yield();
+    }
+    bc.stop = 1;
+    for (int i = 0; i < nthreads; i++) pthread_join(threads[i], NULL);
+
+    qsort(lat, pushes, sizeof(*lat), bench_cmp_u32);
+    printf("  %-18s %8u %8u %8u %10u %8u\n", name, lat[pushes / 2], lat[pushes * 99 / 100],
+        lat[pushes * 999 / 1000], lat[pushes - 1], ring.dropped);
+    free(lat);
+}
+
+static void bench_ring(void) {
+    printf("sample ring push latency (200000 pushes, ns incl. clock read, %ld CPUs)\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("  %-18s %8s %8s %8s %10s %8s\n", "case", "p50", "p99", "p99.9", "max", "dropped");
+    bench_ring_run("inline pop", 0, 0);
+    bench_ring_run("consumer thread", 1, 0);
+    bench_ring_run("consumer+4 memcpy", 1, 4);
+}
+
+/**
+ * 订阅者基准测试
+ * 在临时路径上启动遥测线程，连接0、10、100个订阅者（每个周期推送一个点），
+ * 以5毫秒周期运行模拟的控制循环并记录每个周期的唤醒延迟（相对计划时间）。
+ * 每10个订阅者中有1个从不读取，测试慢订阅者的合并（coalesce）不影响控制循环
+ */
+typedef struct {
+    int* fd;
+    int count;
+    volatile int stop;
+} BenchReader;
+
+// 读取所有正常订阅者的数据（慢订阅者不读）
+static void* bench_subscriber_reader(void* arg) {
+    BenchReader* br = arg;
+    char buf[4096];
+    struct pollfd pfd[100];
+    while (!br->stop) {
+        int n = 0;
+        for (int i = 0; i < br->count; i++) {
+            if (i % 10 == 9) continue;
+            pfd[n].fd = br->fd[i];
+            pfd[n].events = POLLIN;
+            n++;
+        }
+        if (n == 0 || poll(pfd, n, 50) <= 0) {
+            if (n == 0) usleep(50000);
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            if ((pfd[i].revents & POLLIN) && read(pfd[i].fd, buf, sizeof(buf)) < 0) continue;
+        }
+    }
+    return NULL;
+}
+
+static int bench_subscribe(const char* path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    struct {
+        FcCtlHeader hdr;
+        FcCtlWatchReq req;
+    } msg = { { FC_CTL_MAGIC, FC_CTL_WATCH, 0, sizeof(FcCtlWatchReq) }, { 1, 0, FC_CTL_COALESCE, { 0 } } };
+    FcCtlHeader reply;
+    if (write(fd, &msg, sizeof(msg)) != sizeof(msg) ||
+        read(fd, &reply, sizeof(reply)) != sizeof(reply) || reply.status != FC_CTL_OK) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void bench_subscribers_run(const char* path, int count) {
+    const int ticks = 1000;
+    const long period_ns = 5000000;
+    static int fds[100];
+    uint32_t* late = malloc(ticks * sizeof(*late));
+    if (late == NULL) return;
+
+    int connected = 0;
+    for (int i = 0; i < count; i++) {
+        fds[connected] = bench_subscribe(path);
+        if (fds[connected] >= 0) connected++;
+    }
+    BenchReader br = { fds, connected, 0 };
+    pthread_t reader;
+    pthread_create(&reader, NULL, bench_subscriber_reader, &br);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t work_max = 0;
+    SampleRecord rec = { 0 };
+    for (int n = 0; n < ticks; n++) {
+        next.tv_nsec += period_ns;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        uint64_t now = bench_ns();
+        uint64_t due = (uint64_t)next.tv_sec * 1000000000ull + next.tv_nsec;
+        late[n] = (uint32_t)((now - due) / 1000);
+
+        rec.time = now / 1e9;
+        rec.wall = time(NULL);
+        rec.temperature = 50.0 + (n % 100) * 0.01;
+        rec.setpoint = 55;
+        rec.pwm = rec.request = 128;
+        rec.rpm = 1500;
+        sample_ring_push(&sample_ring, &rec);
+        uint64_t work = bench_ns() - now;
+        if (work > work_max) work_max = work;
+    }
+
+    br.stop = 1;
+    pthread_join(reader, NULL);
+    for (int i = 0; i < connected; i++) close(fds[i]);
+    qsort(late, ticks, sizeof(*late), bench_cmp_u32);
+    printf("  %4d/%-4d %8u %8u %8u %10.1f %8u\n", connected, count, late[ticks / 2], late[ticks * 99 / 100],
+        late[ticks - 1], work_max / 1000.0, __atomic_load_n(&sample_ring.dropped, __ATOMIC_RELAXED));
+    free(late);
+    usleep(300000);     // 等遥测线程发现连接关闭
+}
+
+static void bench_subscribers(void) {
+    static char path[64];
+    snprintf(path, sizeof(path), "/tmp/fancontrol-bench.%d.sock", (int)getpid());
+    ctl_socket_path = path;
+    log_interval = INT32_MAX;   // 不写温度日志
+    if (telemetry_start() != 0) return;
+    usleep(100000);
+
+    printf("control tick jitter with subscribers (1000 ticks of 5 ms, us late vs schedule)\n");
+    printf("  %9s %8s %8s %8s %10s %8s\n", "subs", "p50", "p99", "max", "work max", "dropped");
+    bench_subscribers_run(path, 0);
+    bench_subscribers_run(path, 10);
+    bench_subscribers_run(path, 100);
+    unlink(path);
+}
+
+/**
+ * 长期存储：一天（每秒一个点）分别存为 tsdb 块、文本日志和二进制环形缓冲区时的字节数和解码速度
+ * 温度用热模型加噪声生成；filtered 为滤波后的浮点温度（尾数随机），0.1C 为按0.1°C量化后的温度
+ */
+#define BENCH_TSDB_POINTS 86400
+
+static void bench_tsdb_series(FcTsdbPoint* pts, int quantize) {
+    BenchPlant plant = { .temp = 55.0, .heat = 0.25 * (55.0 - BENCH_AMBIENT) / BENCH_TAU };
+    float filtered = plant.temp;
+    int pwm = 128;
+    srand(1);
+    for (int i = 0; i < BENCH_TSDB_POINTS; i++) {
+        if (i % 3600 == 1800) plant.heat *= (i / 3600) % 2 ? 0.7 : 1.3;
+        bench_plant_step(&plant, pwm * 100.0 / 255.0, 1.0);
+        float raw = plant.temp + (rand() % 100 - 50) / 100.0;
+        filtered += (raw - filtered) * 0.3;
+        float temp = quantize ? roundf(filtered * 10) / 10 : filtered;
+        // 与守护进程相同，PWM 每 pid_interval 秒才改变一次
+        if (i % pid_interval == 0 && temp > 55.5 && pwm < 255) pwm += 4;
+        if (i % pid_interval == 0 && temp < 54.5 && pwm > 64) pwm -= 4;
+        pts[i] = (FcTsdbPoint) {
+            .time = 1760000000 + i, .temperature = temp, .setpoint = 55,
+            .pwm = pwm, .request = pwm, .rpm = pwm * 8 + rand() % 20 - 10, .flags = 0,
+        };
+    }
+}
+
+static void bench_tsdb_run(const char* name, const FcTsdbPoint* pts) {
+    const uint32_t limit = sizeof(((FcTsdbBlock*)0)->data) * 8;
+    int max_blocks = BENCH_TSDB_POINTS / 100;
+    FcTsdbBlock* blocks = calloc(max_blocks, sizeof(*blocks));
+    FcTsdbState st = { 0 };
+    int used = 1;
+
+    // 与 tsdb_append 相同的分块方式
+    uint64_t t0 = bench_ns();
+    for (int i = 0; i < BENCH_TSDB_POINTS; i++) {
+        FcTsdbBlock* b = &blocks[used - 1];
+        if (b->bits + FC_TSDB_POINT_BITS_MAX > limit) {
+            b = &blocks[used++];
+            memset(&st, 0, sizeof(st));
+        }
+        fc_tsdb_encode(&st, &pts[i], b->data, &b->bits);
+        b->count++;
+    }
+    uint64_t encode = bench_ns() - t0;
+
+    FcTsdbPoint* out = malloc(BENCH_TSDB_POINTS * sizeof(*out));
+    int n = 0;
+    t0 = bench_ns();
+    for (int k = 0; k < used; k++) {
+        FcTsdbState ds = { 0 };
+        uint32_t pos = 0;
+        for (uint32_t j = 0; j < blocks[k].count; j++) {
+            if (fc_tsdb_decode(&ds, blocks[k].data, blocks[k].bits, &pos, &out[n++]) != 0) {
+                printf("  %-12s decode error in block %d\n", name, k);
+                goto done;
+            }
+        }
+    }
+    uint64_t decode = bench_ns() - t0;
+    int exact = n == BENCH_TSDB_POINTS && memcmp(out, pts, n * sizeof(*out)) == 0;
+
+    // 文本：守护进程写入的温度日志行，以及带全部字段的同类格式
+    char line[128];
+    size_t text_temp = 0, text_all = 0;
+    for (int i = 0; i < BENCH_TSDB_POINTS; i++) {
+        time_t t = pts[i].time;
+        char time_str[20];
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        text_temp += snprintf(line, sizeof(line), "[%s] %.1f\n", time_str, pts[i].temperature);
+        text_all += snprintf(line, sizeof(line), "[%s] %.1f %.0f %d %d %d %u\n", time_str, pts[i].temperature,
+            pts[i].setpoint, pts[i].pwm, pts[i].request, pts[i].rpm, pts[i].flags);
+    }
+
+    // 文本解析速度（带全部字段的格式）
+    char* text = malloc(text_all + 1);
+    char* w = text;
+    for (int i = 0; i < BENCH_TSDB_POINTS; i++) {
+        time_t t = pts[i].time;
+        char time_str[20];
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        w += sprintf(w, "[%s] %.1f %.0f %d %d %d %u\n", time_str, pts[i].temperature,
+            pts[i].setpoint, pts[i].pwm, pts[i].request, pts[i].rpm, pts[i].flags);
+    }
+    // 逐行截断后解析（sscanf 每次调用都会计算整个输入的长度）
+    FcTsdbPoint q;
+    char* r = text;
+    t0 = bench_ns();
+    for (int i = 0; i < BENCH_TSDB_POINTS; i++) {
+        char* end = strchr(r, '\n');
+        *end = '\0';
+        struct tm tm = { 0 };
+        sscanf(r, "[%d-%d-%d %d:%d:%d] %f %f %d %d %d %u", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+            &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &q.temperature, &q.setpoint, &q.pwm, &q.request,
+            &q.rpm, &q.flags);
+        tm.tm_year -= 1900;
+        tm.tm_mon--;
+        q.time = timegm(&tm);
+        r = end + 1;
+    }
+    uint64_t parse = bench_ns() - t0;
+
+    // 二进制环形缓冲区：直接复制定长记录
+    t0 = bench_ns();
+    memcpy(out, pts, BENCH_TSDB_POINTS * sizeof(*out));
+    __asm__ volatile("" : : "r"(out) : "memory");
+    uint64_t copy = bench_ns() - t0;
+
+    double pts_n = BENCH_TSDB_POINTS;
+    printf("  %-10s %-22s %10.2f %12.2f\n", name, "tsdb (block footprint)",
+        used * (double)FC_TSDB_BLOCK_SIZE / pts_n, pts_n / (decode / 1e9) / 1e6);
+    uint64_t bits = 0;
+    for (int k = 0; k < used; k++) bits += blocks[k].bits;
+    printf("  %-10s %-22s %10.2f %12s\n", "", "tsdb (encoded bits)", bits / 8.0 / pts_n, "");
+    printf("  %-10s %-22s %10.2f %12s\n", "", "text log (temp only)", text_temp / pts_n, "");
+    printf("  %-10s %-22s %10.2f %12.2f\n", "", "text (all fields)", text_all / pts_n, pts_n / (parse / 1e9) / 1e6);
+    printf("  %-10s %-22s %10zu %12.2f\n", "", "binary ring (point)", sizeof(FcTsdbPoint), pts_n / (copy / 1e9) / 1e6);
+    printf("  %-10s %-22s %10zu %12s\n", "", "binary ring (sample)", sizeof(SampleRecord), "");
+    printf("  %-10s %d blocks, encode %.1f ns/point, round trip %s\n", "", used, encode / pts_n,
+        exact ? "exact" : "MISMATCH");
+    free(text);
+done:
+    free(out);
+    free(blocks);
+}
+
+static void bench_tsdb(void) {
+    FcTsdbPoint* pts = malloc(BENCH_TSDB_POINTS * sizeof(*pts));
+    printf("time series storage (one day at 1 point/s)\n");
+    printf("  %-10s %-22s %10s %12s\n", "series", "format", "bytes/pt", "decode Mpt/s");
+    bench_tsdb_series(pts, 0);
+    bench_tsdb_run("filtered", pts);
+    bench_tsdb_series(pts, 1);
+    bench_tsdb_run("0.1C", pts);
+    free(pts);
+}
+
+int main(int argc, char* argv[]) {
+    const char* only = argc > 1 ? argv[1] : NULL;
+
+    if (!only || strcmp(only, "controllers") == 0) {
+        bench_controllers();
+        bench_pid_saturation();
+    }
+    if (!only || strcmp(only, "sysfs") == 0) bench_sysfs();
+    if (!only || strcmp(only, "ring") == 0) bench_ring();
+    if (!only || strcmp(only, "subscribers") == 0) bench_subscribers();
+    if (!only || strcmp(only, "tsdb") == 0) bench_tsdb();
+    return 0;
+}
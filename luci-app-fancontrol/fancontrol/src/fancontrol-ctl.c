@@ -0,0 +1,591 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "fancontrol_status.h"
+#include "fancontrol_ctl.h"
+#include "fancontrol_history.h"
+#include "fancontrol_tsdb.h"
+
+/**
+ * fancontrol-ctl：查询和控制运行中的 fancontrol
+ * status 直接读取共享内存状态页，series 直接读取长期时序存储，其余子命令通过控制套接字通信（协议见 fancontrol_ctl.h）
+ * 以 fancontrol-status 的名字运行时等同于 fancontrol-ctl status
+ */
+
+#define STALE_SECONDS 5     // 超过该时间未更新视为守护进程未运行
+
+/**
+ * 数据点列表的输出格式
+ */
+#define OUTPUT_PLAIN  0     // 表格
+#define OUTPUT_JSON   1     // JSON数组
+#define OUTPUT_BASE64 2     // 守护进程应答的压缩数据，base64编码（供LuCI页面解码）
+
+static const char* status_file = FC_STATUS_FILE;
+static const char* socket_path = FC_CTL_SOCKET;
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-f status_file] [-S socket] <command> [options]\n", prog);
+    fprintf(stderr, "Commands:\n");
+    fprintf(stderr, "  status [-j] [-w seconds]        current state, optionally repeated\n");
+    fprintf(stderr, "  history [-r range] [-s step] [-j|-b]\n");
+    fprintf(stderr, "                                  averaged history, e.g. -r 24h -s 5m; -b prints the\n");
+    fprintf(stderr, "                                  compact encoding as base64\n");
+    fprintf(stderr, "  trace [-j]                      per-second records of the last 10 minutes\n");
+    fprintf(stderr, "  series [-f file] [-r range] [-j|-i]\n");
+    fprintf(stderr, "                                  per-second records from the long-term store (tsdb_size),\n");
+    fprintf(stderr, "                                  -i prints block usage and compression\n");
+    fprintf(stderr, "  watch [-j|-e] [-n cycles] [-q size] [-d]\n");
+    fprintf(stderr, "                                  stream records, averaged over n cycles; when more than\n");
+    fprintf(stderr, "                                  size records are waiting, merge them (or disconnect with -d);\n");
+    fprintf(stderr, "                                  -e prints JSON as Server-Sent Events\n");
+    fprintf(stderr, "  set <name> <value>              change a setting until the next reload\n");
+    fprintf(stderr, "  calibrate                       re-run fan calibration (refused above the target temperature)\n");
+}
+
+// 结果码对应的错误信息
+static const char* ctl_strerror(int status) {
+    switch (status) {
+        case FC_CTL_OK: return "ok";
+        case FC_CTL_EINVAL: return "invalid request or value out of range";
+        case FC_CTL_ENOENT: return "unknown setting";
+        case FC_CTL_EBUSY: return "daemon busy, try again";
+        case FC_CTL_ETYPE: return "command not supported by the daemon";
+        case FC_CTL_EHOT: return "temperature above target, calibration refused";
+        default: return "unknown error";
+    }
+}
+
+/**
+ * 解析时间长度（支持 s/m/h/d 后缀，无后缀为秒）
+ * @return 秒数，格式错误返回-1
+ */
+static long parse_duration(const char* str) {
+    char* end;
+    long value = strtol(str, &end, 10);
+    if (end == str || value < 0) return -1;
+    switch (*end) {
+        case '\0':
+        case 's': break;
+        case 'm': value *= 60; break;
+        case 'h': value *= 3600; break;
+        case 'd': value *= 86400; break;
+        default: return -1;
+    }
+    if (*end != '\0' && end[1] != '\0') return -1;
+    return value;
+}
+
+// 距离上次更新的秒数
+static double status_age(const FcStatus *st) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9 - st->mono;
+}
+
+static void print_status_plain(const FcStatus *st) {
+    printf("pid=%d\n", st->daemon_pid);
+    printf("ticks=%llu\n", (unsigned long long)st->ticks);
+    printf("age=%.1f\n", status_age(st));
+    printf("running=%d\n", st->ticks > 0 && status_age(st) < STALE_SECONDS);
+    printf("controller=%s\n", st->controller);
+    printf("temperature=%.2f\n", st->temperature);
+    printf("hottest=%.2f\n", st->hottest);
+    printf("setpoint=%.1f\n", st->setpoint);
+    printf("pwm=%d\n", st->pwm);
+    printf("request=%d\n", st->request);
+    printf("speed_limit=%d\n", st->speed_limit);
+    printf("rpm=%d\n", st->rpm);
+    printf("target_rpm=%d\n", st->target_rpm);
+    printf("output=%.2f\n", st->output);
+    printf("p=%.2f\ni=%.2f\nd=%.2f\nff=%.2f\n", st->p_term, st->i_term, st->d_term, st->ff_term);
+    printf("failsafe=%d\n", !!(st->flags & FC_FLAG_FAILSAFE));
+    printf("critical=%d\n", !!(st->flags & FC_FLAG_CRITICAL));
+    printf("stopped=%d\n", !!(st->flags & FC_FLAG_STOPPED));
+    printf("schedule=%d\n", !!(st->flags & FC_FLAG_SCHEDULE));
+    printf("kick=%d\n", !!(st->flags & FC_FLAG_KICK));
+    printf("cascade=%d\n", !!(st->flags & FC_FLAG_CASCADE));
+    for (int i = 0; i < st->sensor_count && i < FC_STATUS_SENSORS; i++) {
+        printf("sensor%d=%.2f %d\n", i + 1, st->sensor[i].temperature, st->sensor[i].valid);
+    }
+}
+
+static void print_status_json(const FcStatus *st) {
+    printf("{\"pid\":%d,\"ticks\":%llu,\"age\":%.1f,\"running\":%s,\"controller\":\"%s\",",
+        st->daemon_pid, (unsigned long long)st->ticks, status_age(st),
+        st->ticks > 0 && status_age(st) < STALE_SECONDS ? "true" : "false", st->controller);
+    printf("\"temperature\":%.2f,\"hottest\":%.2f,\"setpoint\":%.1f,", st->temperature, st->hottest, st->setpoint);
+    printf("\"pwm\":%d,\"request\":%d,\"speed_limit\":%d,\"rpm\":%d,\"target_rpm\":%d,",
+        st->pwm, st->request, st->speed_limit, st->rpm, st->target_rpm);
+    printf("\"output\":%.2f,\"p\":%.2f,\"i\":%.2f,\"d\":%.2f,\"ff\":%.2f,",
+        st->output, st->p_term, st->i_term, st->d_term, st->ff_term);
+    printf("\"flags\":%u,\"sensors\":[", st->flags);
+    for (int i = 0; i < st->sensor_count && i < FC_STATUS_SENSORS; i++) {
+        printf("%s{\"temperature\":%.2f,\"valid\":%s}", i ? "," : "",
+            st->sensor[i].temperature, st->sensor[i].valid ? "true" : "false");
+    }
+    printf("]}\n");
+}
+
+static void print_point(const FcCtlPoint *p, int json) {
+    if (json) {
+        printf("{\"time\":%u,\"temperature\":%.2f,\"setpoint\":%.2f,\"pwm\":%u,\"request\":%u,\"rpm\":",
+            p->time, p->temperature / 100.0, p->setpoint / 100.0, p->pwm, p->request);
+        if (p->rpm == FC_CTL_NO_RPM) {
+            printf("null");
+        } else {
+            printf("%u", p->rpm);
+        }
+        printf(",\"flags\":%u", p->flags);
+        if (p->skipped) printf(",\"skipped\":%u", p->skipped);
+        printf("}");
+        return;
+    }
+    if (p->skipped) printf("# %u records skipped\n", p->skipped);
+    char time_str[20];
+    time_t t = p->time;
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    printf("%s %6.2f %5.1f %3u %3u ", time_str, p->temperature / 100.0, p->setpoint / 100.0, p->pwm, p->request);
+    if (p->rpm == FC_CTL_NO_RPM) {
+        printf("    -");
+    } else {
+        printf("%5u", p->rpm);
+    }
+    printf(" 0x%02x\n", p->flags);
+}
+
+static void print_points_header(void) {
+    printf("# time                temp    set pwm req   rpm flags\n");
+}
+
+/**
+ * 连接控制套接字
+ * @return 文件描述符，失败返回-1
+ */
+static int ctl_connect(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Cannot connect to %s: %s, is fancontrol running?\n", socket_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int read_full(int fd, void *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, (char*)buf + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        done += n;
+    }
+    return 0;
+}
+
+static int ctl_send(int fd, int type, const void *payload, uint32_t len) {
+    FcCtlHeader hdr = { .magic = FC_CTL_MAGIC, .type = type, .len = len };
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) return -1;
+    if (len > 0 && write(fd, payload, len) != (ssize_t)len) return -1;
+    return 0;
+}
+
+/**
+ * 接收一条消息，负载存入新分配的缓冲区
+ * @return 成功返回0，连接关闭或格式错误返回-1
+ */
+static int ctl_recv(int fd, FcCtlHeader *hdr, void **payload) {
+    *payload = NULL;
+    if (read_full(fd, hdr, sizeof(*hdr)) != 0) return -1;
+    if (hdr->magic != FC_CTL_MAGIC || hdr->len > FC_CTL_PAYLOAD_MAX) {
+        fprintf(stderr, "Unexpected reply from daemon\n");
+        return -1;
+    }
+    if (hdr->len == 0) return 0;
+    *payload = malloc(hdr->len);
+    if (*payload == NULL || read_full(fd, *payload, hdr->len) != 0) {
+        free(*payload);
+        *payload = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 发送请求并接收应答
+ * @return 成功返回0，失败时已输出错误信息并返回-1
+ */
+static int ctl_request(int fd, int type, const void *req, uint32_t len, FcCtlHeader *hdr, void **payload) {
+    if (ctl_send(fd, type, req, len) != 0 || ctl_recv(fd, hdr, payload) != 0) {
+        fprintf(stderr, "Connection to daemon lost\n");
+        return -1;
+    }
+    if (hdr->status != FC_CTL_OK) {
+        fprintf(stderr, "Error: %s\n", ctl_strerror(hdr->status));
+        free(*payload);
+        *payload = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// 输出 base64 编码
+static void print_base64(const uint8_t *buf, size_t len) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)buf[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)buf[i + 1] << 8;
+        if (i + 2 < len) v |= buf[i + 2];
+        putchar(table[(v >> 18) & 0x3f]);
+        putchar(table[(v >> 12) & 0x3f]);
+        putchar(i + 1 < len ? table[(v >> 6) & 0x3f] : '=');
+        putchar(i + 2 < len ? table[v & 0x3f] : '=');
+    }
+    putchar('\n');
+}
+
+// 请求并输出数据点列表（history、trace）
+static int request_points(int type, const void *req, uint32_t len, int format) {
+    int fd = ctl_connect();
+    if (fd < 0) return EXIT_FAILURE;
+    FcCtlHeader hdr;
+    void *payload;
+    int ret = ctl_request(fd, type, req, len, &hdr, &payload);
+    close(fd);
+    if (ret != 0) return EXIT_FAILURE;
+
+    if (format == OUTPUT_BASE64) {
+        print_base64(payload, hdr.len);
+        free(payload);
+        return EXIT_SUCCESS;
+    }
+
+    FcHistState st = { 0 };
+    FcCtlPoint p;
+    size_t pos = 0;
+    int n = 0;
+    if (format == OUTPUT_JSON) printf("[");
+    else print_points_header();
+    while ((ret = fc_hist_decode(&st, payload, hdr.len, &pos, &p)) == 1) {
+        if (format == OUTPUT_JSON && n > 0) printf(",");
+        print_point(&p, format == OUTPUT_JSON);
+        n++;
+    }
+    if (format == OUTPUT_JSON) printf("]\n");
+    free(payload);
+    if (ret < 0) {
+        fprintf(stderr, "Malformed history data after %d records\n", n);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int cmd_status(int argc, char *argv[]) {
+    int json = 0;
+    int watch = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:jw:")) != -1) {
+        switch (opt) {
+            case 'f': status_file = optarg; break;
+            case 'j': json = 1; break;
+            case 'w': watch = atoi(optarg); break;
+            default: return EXIT_FAILURE;
+        }
+    }
+
+    const FcStatus *page = fc_status_map(status_file);
+    if (page == NULL) {
+        fprintf(stderr, "Cannot map status page %s, is fancontrol running?\n", status_file);
+        return EXIT_FAILURE;
+    }
+
+    do {
+        FcStatus st;
+        if (fc_status_read(page, &st) != 0) {
+            fprintf(stderr, "Status page is being rewritten, try again\n");
+            fc_status_unmap(page);
+            return EXIT_FAILURE;
+        }
+        if (json) {
+            print_status_json(&st);
+        } else {
+            print_status_plain(&st);
+        }
+        fflush(stdout);
+        if (watch > 0) sleep(watch);
+    } while (watch > 0);
+
+    fc_status_unmap(page);
+    return EXIT_SUCCESS;
+}
+
+static int cmd_history(int argc, char *argv[]) {
+    FcCtlHistoryReq req = { .range = 3600, .resolution = 0 };
+    int format = OUTPUT_PLAIN;
+    int opt;
+    long value;
+    while ((opt = getopt(argc, argv, "r:s:jb")) != -1) {
+        switch (opt) {
+            case 'r':
+                if ((value = parse_duration(optarg)) <= 0) {
+                    fprintf(stderr, "Invalid range '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                req.range = value;
+                break;
+            case 's':
+                if ((value = parse_duration(optarg)) < 0) {
+                    fprintf(stderr, "Invalid step '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                req.resolution = value;
+                break;
+            case 'j': format = OUTPUT_JSON; break;
+            case 'b': format = OUTPUT_BASE64; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    return request_points(FC_CTL_HISTORY, &req, sizeof(req), format);
+}
+
+static int cmd_trace(int argc, char *argv[]) {
+    int format = OUTPUT_PLAIN;
+    int opt;
+    while ((opt = getopt(argc, argv, "j")) != -1) {
+        if (opt != 'j') return EXIT_FAILURE;
+        format = OUTPUT_JSON;
+    }
+    return request_points(FC_CTL_TRACE, NULL, 0, format);
+}
+
+static int cmd_watch(int argc, char *argv[]) {
+    FcCtlWatchReq req = { .decimation = 1, .queue = 0, .policy = FC_CTL_COALESCE };
+    int json = 0;
+    int sse = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "jen:q:d")) != -1) {
+        switch (opt) {
+            case 'j': json = 1; break;
+            case 'e': json = sse = 1; break;
+            case 'n': req.decimation = atoi(optarg); break;
+            case 'q': req.queue = atoi(optarg); break;
+            case 'd': req.policy = FC_CTL_DISCONNECT; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+
+    int fd = ctl_connect();
+    if (fd < 0) return EXIT_FAILURE;
+    FcCtlHeader hdr;
+    void *payload;
+    if (ctl_request(fd, FC_CTL_WATCH, &req, sizeof(req), &hdr, &payload) != 0) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    if (sse) {
+        // 连接断开后浏览器5秒后重连
+        printf("retry: 5000\n\n");
+    } else if (!json) {
+        print_points_header();
+    }
+    // 每条消息输出一行（SSE为一个事件），直到守护进程关闭连接或输出端关闭
+    while (ctl_recv(fd, &hdr, &payload) == 0) {
+        if (hdr.type == FC_CTL_WATCH && hdr.len == sizeof(FcCtlPoint)) {
+            if (sse) printf("data: ");
+            print_point(payload, json);
+            if (json) printf(sse ? "\n\n" : "\n");
+        }
+        free(payload);
+        if (fflush(stdout) != 0) break;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+static int cmd_set(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: set <name> <value>\n");
+        return EXIT_FAILURE;
+    }
+    FcCtlSetReq req = { 0 };
+    if (strlen(argv[1]) >= sizeof(req.name)) {
+        fprintf(stderr, "Error: %s\n", ctl_strerror(FC_CTL_ENOENT));
+        return EXIT_FAILURE;
+    }
+    char* end;
+    req.value = strtof(argv[2], &end);
+    if (end == argv[2] || *end != '\0') {
+        fprintf(stderr, "Invalid value '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    strcpy(req.name, argv[1]);
+
+    int fd = ctl_connect();
+    if (fd < 0) return EXIT_FAILURE;
+    FcCtlHeader hdr;
+    void *payload;
+    int ret = ctl_request(fd, FC_CTL_SET, &req, sizeof(req), &hdr, &payload);
+    close(fd);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+typedef struct {
+    int json;
+    long count;             // 已输出的点数
+} SeriesOutput;
+
+// 输出长期存储中的一个点（保留完整的温度精度）
+static void print_series_point(const FcTsdbPoint *p, void *arg) {
+    SeriesOutput *out = arg;
+    if (out->json) {
+        printf("%s{\"time\":%u,\"temperature\":%.3f,\"setpoint\":%.1f,\"pwm\":%d,\"request\":%d,\"rpm\":",
+            out->count++ ? "," : "", p->time, p->temperature, p->setpoint, p->pwm, p->request);
+        if (p->rpm < 0) {
+            printf("null");
+        } else {
+            printf("%d", p->rpm);
+        }
+        printf(",\"flags\":%u}", p->flags);
+        return;
+    }
+    char time_str[20];
+    time_t t = p->time;
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    printf("%s %7.3f %5.1f %3d %3d ", time_str, p->temperature, p->setpoint, p->pwm, p->request);
+    if (p->rpm < 0) {
+        printf("    -");
+    } else {
+        printf("%5d", p->rpm);
+    }
+    printf(" 0x%02x\n", p->flags);
+    out->count++;
+}
+
+// 输出长期存储的块使用情况和压缩率
+static void print_series_info(const FcTsdbHeader *h) {
+    uint32_t used = 0, sealed = 0, first = 0, last = 0;
+    unsigned long long points = 0, bits = 0;
+    FcTsdbBlock b;
+    for (uint32_t i = 0; i < h->blocks; i++) {
+        if (fc_tsdb_read_block(fc_tsdb_block(h, i), &b) != 0 || b.count == 0) continue;
+        used++;
+        if (b.sealed) sealed++;
+        points += b.count;
+        bits += b.bits;
+        if (first == 0 || b.first < first) first = b.first;
+        if (b.last > last) last = b.last;
+    }
+    printf("pid=%d\n", h->daemon_pid);
+    printf("blocks=%u\nused=%u\nsealed=%u\n", h->blocks, used, sealed);
+    printf("points=%llu\n", points);
+    printf("span=%u\n", used ? last - first : 0);
+    printf("bytes_per_point=%.2f\n", points ? bits / 8.0 / points : 0.0);
+    printf("capacity=%.0f\n", points ? (double)h->blocks * sizeof(b.data) * 8 / bits * points : 0.0);
+}
+
+static int cmd_series(int argc, char *argv[]) {
+    const char* file = FC_TSDB_FILE;
+    long range = 3600;
+    int json = 0;
+    int info = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:ji")) != -1) {
+        switch (opt) {
+            case 'f': file = optarg; break;
+            case 'r':
+                if ((range = parse_duration(optarg)) <= 0) {
+                    fprintf(stderr, "Invalid range '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'j': json = 1; break;
+            case 'i': info = 1; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+
+    const FcTsdbHeader *h = fc_tsdb_map(file);
+    if (h == NULL) {
+        fprintf(stderr, "Cannot map time series store %s, is tsdb_size set?\n", file);
+        return EXIT_FAILURE;
+    }
+    if (info) {
+        print_series_info(h);
+        fc_tsdb_unmap(h);
+        return EXIT_SUCCESS;
+    }
+
+    uint32_t now = time(NULL);
+    uint32_t from = range < now ? now - range : 0;
+    SeriesOutput out = { .json = json };
+    if (json) printf("[");
+    else print_points_header();
+    long ret = fc_tsdb_scan(h, from, UINT32_MAX, print_series_point, &out);
+    if (json) printf("]\n");
+    fc_tsdb_unmap(h);
+    if (ret < 0) {
+        fprintf(stderr, "Time series store is corrupted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int cmd_calibrate(void) {
+    int fd = ctl_connect();
+    if (fd < 0) return EXIT_FAILURE;
+    FcCtlHeader hdr;
+    void *payload;
+    int ret = ctl_request(fd, FC_CTL_CALIBRATE, NULL, 0, &hdr, &payload);
+    close(fd);
+    if (ret == 0) printf("Calibration started, the fan will sweep through its speed range\n");
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+    const char* prog = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+    if (strcmp(prog, "fancontrol-status") == 0) {
+        return cmd_status(argc, argv);
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "+f:S:h")) != -1) {
+        switch (opt) {
+            case 'f': status_file = optarg; break;
+            case 'S': socket_path = optarg; break;
+            default:
+                usage(prog);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+
+    // 子命令从自己的参数开始重新解析选项
+    const char* cmd = argv[optind];
+    argc -= optind;
+    argv += optind;
+    optind = 0;
+
+    if (strcmp(cmd, "status") == 0) return cmd_status(argc, argv);
+    if (strcmp(cmd, "history") == 0) return cmd_history(argc, argv);
+    if (strcmp(cmd, "trace") == 0) return cmd_trace(argc, argv);
+    if (strcmp(cmd, "series") == 0) return cmd_series(argc, argv);
+    if (strcmp(cmd, "watch") == 0) return cmd_watch(argc, argv);
+    if (strcmp(cmd, "set") == 0) return cmd_set(argc, argv);
+    if (strcmp(cmd, "calibrate") == 0) return cmd_calibrate();
+
+    fprintf(stderr, "Unknown command '%s'\n", cmd);
+    usage(prog);
+    return EXIT_FAILURE;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <signal.h>
@@ -8,14 +9,76 @@
 #include <getopt.h>
 #include <sys/types.h>
 #include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+
+// 内核头文件提供 io_uring 时编译 io_uring 批量读取，否则只使用 pread
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
 
 #define _POSIX_C_SOURCE 200809L
 
+#include "fancontrol_status.h"
+#include "fancontrol_ctl.h"
+#include "fancontrol_history.h"
+#include "fancontrol_tsdb.h"
+
 /**
  * 常量定义
  */
 #define MAX_LENGTH 200      // 文件路径最大长度
 #define MAX_TEMP 120        // 最大温度限制（摄氏度）
+#define PROFILE_DIR "/etc/fancontrol"   // 风扇标定曲线保存目录
+#define PROFILE_MAX_POINTS 40           // 标定曲线最大点数
+#define CALIBRATE_STEP 8                // 标定扫描的PWM步长
+#define FILTER_MEDIAN_MAX 9             // 中值滤波最大窗口
+#define OVERSAMPLE_SPAN_MS 200          // 过采样读取分布的时间范围（毫秒）
+#define SENSOR_MAX 8                    // 每个区域最多融合的温度传感器数
+#define SAMPLE_RING_SIZE 256            // 采样记录环形队列长度（2的幂）
+#define TRACE_SIZE 600                  // 跟踪缓冲区保存的采样记录数（每秒1条，即10分钟）
+#define TRACE_FILE "/tmp/log/fancontrol.trace"     // 跟踪缓冲区导出文件（SIGUSR1）
+#define TELEMETRY_NICE 10               // 遥测线程的nice值
+#define HISTORY_TIERS 3                 // 历史记录分级数量（10秒/1分钟/10分钟）
+#define HISTORY_BLOCK_BYTES 512         // 历史记录压缩块大小
+#define HISTORY_POINT_BYTES 6           // 估计的每个点压缩后的平均字节数，用于确定块数量
+#define CTL_REPLY_TIMEOUT 10            // 应答在该时间（秒）内仍未被对方读完时关闭连接
+#define CONTROL_QUEUE_SIZE 16           // 控制命令队列长度（2的幂）
+#define CTL_CLIENTS_MAX 128             // 控制套接字最大连接数（含订阅者）
+#define SYSFS_BUF 16                    // sysfs属性读取缓冲区大小
+#define SYSFS_BATCH_MAX 64              // 一次批量读写的最大属性数
+#define SENSOR_SLOT_MAX_AGE 5.0         // 异步读取的缓存值超过该时间（秒）未更新视为读取失败
+#define SENSOR_FILE "/tmp/log/fancontrol.sensors"  // 传感器读数和融合结果输出文件
+#define MODEL_FILE "/tmp/log/fancontrol.model"  // 在线辨识模型参数输出文件
+#define CPU_MAX 32                      // 前馈统计的最大CPU核数
+#define FF_UPDATE_STEP 2.0              // 前馈变化超过该值（%）时立即更新输出，不等待PID周期
+#define NET_IFACE_MAX 8                 // 网络前馈最多统计的接口数
+#define AIRTIME_MAX 4                   // 最多统计的无线射频数
+#define FF_TABLE_MAX 8                  // 网络前馈增益表最大点数
+#define CURVE_POINTS_MAX 16             // 风扇曲线最大点数
+#define CURVE_MIN_STEP 0.01             // 曲线查找表最小温度步长（°C）
+#define CURVE_LUT_SIZE (MAX_TEMP * 100 + 1) // 曲线查找表大小（0到MAX_TEMP，按最小步长）
+#define CONTROLLER_SNAPSHOT_MAX 64      // 控制器运行状态快照最大字节数
+#define OUTPUT_FILE "/tmp/log/fancontrol.output"    // PWM输出统计文件
+#define SCHEDULE_MAX 8                  // 静音时段最大条目数
+#define SCHEDULE_WEEK (7 * 24 * 60)     // 一周的分钟数
+#define PWM_REFRESH_TIME 60             // PWM值未变化时重新写入的间隔（秒），防止被其他程序修改后不恢复
 
 /**
  * 全局变量定义
@@ -33,11 +96,124 @@ int debug_mode = 0;     // 调试模式标志 (-D)
 
 // 配置参数
 float Kp = 5.0;         // PID比例增益系数
-float Ki = 1.0;         // PID积分增益系数
-float Kd = 0.01;        // PID微分增益系数
-int log_interval = 10;  // 日志记录间隔（秒）
+float Ki = 0.03;        // PID积分增益系数（%/(°C·秒)）
+float Kd = 0.3;         // PID微分增益系数（%/(°C/秒)）
+float Kb = 1.0;         // PID反算抗饱和增益（每秒），越大输出饱和后恢复越快，Kb*dt 上限为1
+int log_interval = 10;  // 日志记录间隔（秒），遥测线程也读取，重新加载时原子写入
+int tsdb_size = 0;      // 长期时序存储大小（KiB），0表示不启用；遥测线程也读取，重新加载时原子写入
 int pid_interval = 30;   // PID控制间隔（秒）
 
+// 停转检测参数
+int stall_timeout = 5;  // PWM>0 但转速持续为0超过该时间（秒）判定为停转
+int kick_time = 2;      // 停转后全速启动脉冲持续时间（秒）
+int stall_alarm = 3;    // 连续停转达到该次数时告警
+
+// PWM输出整形参数
+float pwm_slew_up = 0;      // 升速最大变化率（PWM/秒），0表示不限制
+float pwm_slew_down = 0;    // 降速最大变化率（PWM/秒），0表示不限制
+int pwm_deadband = 0;       // 与当前输出相差小于该值时不改变输出
+int pwm_dwell = 0;          // 输出改变后至少保持的时间（秒）
+
+// 停转（零转速）模式参数
+int zero_rpm = 0;               // 是否启用停转模式
+float zero_rpm_stop_temp = 40;  // 温度降到该值以下时停止风扇
+float zero_rpm_start_temp = 48; // 温度升到该值以上时启动风扇
+int zero_rpm_min_off = 60;      // 停止后至少保持的时间（秒）
+int zero_rpm_min_on = 120;      // 启动后至少运行的时间（秒）
+
+// 静音时段（config schedule 配置段），按配置顺序第一个匹配的条目生效
+typedef struct {
+    int enabled;            // 是否启用
+    int days;               // 星期位掩码，bit0为周日
+    int start;              // 开始时间（当天分钟数）
+    int length;             // 持续时间（分钟），结束时间不晚于开始时间时跨越午夜
+    int max_speed;          // PWM上限，-1表示不限制
+    int max_rpm;            // 串级模式目标转速上限，-1表示不限制
+    int temp_offset;        // 目标温度偏移（°C）
+    char controller[16];    // 时段内使用的控制器，空表示不改变
+} ScheduleEntry;
+
+ScheduleEntry schedule[SCHEDULE_MAX];
+int schedule_count = 0;
+int schedule_override_temp = 70;    // 温度达到该值时忽略时段的上限和目标温度偏移
+
+// 串级控制参数（外环温度 PID 给出目标转速，内环按转速反馈调节PWM）
+int cascade = 0;        // 是否启用串级控制
+int max_rpm = 0;        // 最大速度对应的风扇转速（RPM），串级模式必须配置
+float rpm_Kp = 0.02;    // 内环比例增益（PWM/RPM）
+float rpm_Ki = 0.1;     // 内环积分增益（PWM/(RPM·秒)）
+int rpm_interval = 250; // 内环周期（毫秒）
+
+// 风扇标定参数
+int calibrate = 0;      // 是否使用标定曲线（不存在时自动标定一次）
+int calibrate_force = 0;// 强制重新标定 (-C)
+int calibrate_settle = 3;   // 标定时每个PWM点的稳定时间（秒）
+
+// 传感器预滤波参数
+int filter_median = 1;          // 中值滤波窗口（奇数，1表示不做中值滤波）
+char filter_type[16] = "none";  // 低通滤波类型：none、ema、biquad
+float filter_alpha = 0.3;       // EMA平滑系数 (0-1]，越小越平滑
+float filter_cutoff = 0.05;     // biquad低通截止频率（Hz，采样率为1Hz）
+int oversample = 1;             // 每次采样读取传感器的次数，取平均提高分辨率
+
+// 多传感器融合参数（未配置 sensor 列表时只使用 thermal_file）
+char sensor_path[SENSOR_MAX][MAX_LENGTH];   // 传感器文件
+float sensor_offset[SENSOR_MAX];            // 读数偏移（°C），用于折算到同一基准
+float sensor_weight[SENSOR_MAX];            // 权重（加权平均）或可信度（卡尔曼）
+int sensor_count = 0;
+char sensor_fusion[8] = "max";  // 融合方式：max、mean、kalman
+float fusion_q = 0.05;          // 卡尔曼过程噪声（°C²/秒），越大跟随越快
+float fusion_r = 1.0;           // 卡尔曼测量噪声（°C²），按权重缩放
+int sensor_async = 0;           // 在独立线程中读取传感器，控制循环只读取缓存值
+int io_uring_enable = 0;        // 用 io_uring 一次提交所有传感器读取（内核不支持时使用 pread）
+
+// 失效保护参数
+int failsafe_reads = 3;         // 连续读取失败达到该次数时进入失效保护
+int failsafe_speed = 255;       // 失效保护时的PWM值
+int stale_timeout = 0;          // 温度值持续不变超过该时间（秒）视为传感器失效，0表示不检测
+int critical_temp = 85;         // 达到该温度时立即全速运行，0表示不启用
+
+// 继电反馈自整定参数
+int autotune = 0;               // 启动时执行一次自整定，完成后自动清零
+int autotune_force = 0;         // 命令行要求自整定 (-A)
+char autotune_rule[8] = "tl";   // 整定规则：zn (Ziegler-Nichols)、tl (Tyreus-Luyben)、simc
+char autotune_force_rule[8];    // 命令行指定的整定规则
+float autotune_low = 0.0;       // 继电低输出（%），高输出固定为100%
+int autotune_max_temp = 0;      // 自整定期间允许的最高温度，0表示目标温度+10°C
+int autotune_timeout = 3600;    // 自整定超时时间（秒）
+
+// 在线热模型辨识参数
+int model_adapt = 0;            // 是否根据辨识模型自适应调整PID参数
+float model_adapt_range = 2.0;  // 自适应参数相对配置值的最大倍数范围
+
+// CPU负载前馈参数
+float ff_cpu_gain = 0.0;        // CPU满载时附加的风扇输出（%），0表示不启用
+char ff_cpu_source[16] = "total";   // 负载来源：total（总体利用率）、max_core（最忙的核）
+int ff_cpu_learn = 0;           // 是否根据PID积分项在线学习前馈增益
+float ff_cpu_learn_rate = 0.01; // 前馈增益学习速率
+
+// 网络流量前馈参数
+char ff_net_iface[NET_IFACE_MAX][16];   // 统计的网络设备名（如 pppoe-wan、br-lan）
+int ff_net_iface_count = 0;
+char ff_net_metric[8] = "mbps";         // 增益表的横坐标：mbps（收发总速率）或 kpps（收发总包率）
+float ff_net_rate[FF_TABLE_MAX];        // 增益表：流量
+float ff_net_output[FF_TABLE_MAX];      // 增益表：附加风扇输出（%）
+int ff_net_points = 0;
+char ff_airtime_file[AIRTIME_MAX][MAX_LENGTH];  // 射频信道忙碌时间累计值文件（微秒）
+int ff_airtime_count = 0;
+float ff_airtime_gain = 0.0;            // 射频100%忙碌时附加的风扇输出（%）
+
+// 控制器选择和风扇曲线参数
+char controller[16] = "pid";            // 控制器：pid、curve 或 bang
+float curve_temp[CURVE_POINTS_MAX];     // 曲线点温度（°C，递增）
+int curve_pwm[CURVE_POINTS_MAX];        // 曲线点PWM (0-255)
+int curve_points = 0;
+float curve_hyst_rise = 0.0;            // 升温滞环（°C），温度需高出上次取值点该值后输出才升高
+float curve_hyst_fall = 2.0;            // 降温滞环（°C），温度需低于上次取值点该值后输出才降低
+float bang_hyst = 2.0;                  // 开关控制滞环（°C），高于目标温度该值时全速，低于该值时停止
+
+char config_file[MAX_LENGTH] = "/etc/config/fancontrol";                                 // 配置文件路径 (-c)
+
 /**
  * 去除字符串两端的空白字符
  * @param str 要处理的字符串
@@ -61,6 +237,65 @@ static char* trim(char* str) {
     return str;
 }
 
+/**
+ * 解析时间 HH:MM（24:00 等同于 00:00）
+ * @return 当天的分钟数，格式错误返回-1
+ */
+static int parse_time_of_day(const char* str) {
+    int h, m, n = 0;
+    if (sscanf(str, "%d:%d%n", &h, &m, &n) != 2 || str[n] != '\0' ||
+        h < 0 || h > 24 || m < 0 || m > 59 || (h == 24 && m != 0)) {
+        return -1;
+    }
+    return (h * 60 + m) % (24 * 60);
+}
+
+/**
+ * 解析星期列表，如 'mon tue'、'mon-fri'、'sat,sun'
+ * @return 星期位掩码（bit0为周日），为空时表示每天
+ */
+static int parse_days(const char* str) {
+    static const char* names[] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat" };
+    int mask = 0, prev = -1, range = 0;
+    for (const char* p = str; *p; ) {
+        if (*p == '-') {
+            range = 1;
+            p++;
+            continue;
+        }
+        if (!isalpha((unsigned char)*p)) {
+            p++;
+            continue;
+        }
+        int day = -1;
+        for (int i = 0; i < 7; i++) {
+            if (strncasecmp(p, names[i], 3) == 0) day = i;
+        }
+        while (isalpha((unsigned char)*p)) p++;
+        if (day < 0) continue;
+        if (range && prev >= 0) {
+            for (int d = prev; d != day; d = (d + 1) % 7) mask |= 1 << d;
+        }
+        mask |= 1 << day;
+        prev = day;
+        range = 0;
+    }
+    return mask ? mask : 0x7f;
+}
+
+// 时段长度（分钟），结束时间不晚于开始时间时跨越午夜（相同时为全天）
+static int schedule_length(int start, int end) {
+    return end > start ? end - start : end - start + 24 * 60;
+}
+
+static ScheduleEntry schedule_ignored;  // 超出条目数的配置段解析到这里后丢弃
+
+// 结束一个静音时段配置段：计算时长；时间格式错误时丢弃该条目（总是最后一个）
+static void schedule_seal(ScheduleEntry* entry, int end, int bad) {
+    entry->length = schedule_length(entry->start, end);
+    if (bad && entry != &schedule_ignored) schedule_count--;
+}
+
 /**
  * 解析配置文件
  * @param config_file 配置文件路径
@@ -77,30 +312,99 @@ static int parse_config_file(const char* config_file) {
         fprintf(stderr, "Warning: Cannot open config file: %s\n", config_file);
         return -1;
     }
+
+    // 列表类配置重新加载时从空开始
+    ff_net_iface_count = 0;
+    ff_net_points = 0;
+    ff_airtime_count = 0;
+    curve_points = 0;
+    sensor_count = 0;
+    schedule_count = 0;
+    ScheduleEntry* entry = NULL;    // 当前解析的静音时段配置段，NULL表示主配置段
+    int entry_end = 0;
+    int entry_bad = 0;              // 当前静音时段有格式错误的时间，整段忽略
     
     while (fgets(line, sizeof(line), fp)) {
-        // 跳过注释行和空行
-        if (line[0] == '#' || line[0] == '\n') continue;
-        
         // 去除换行符
         line[strcspn(line, "\n")] = 0;
-        
-        // 查找等号
-        char* equals = strchr(line, '=');
-        if (equals == NULL) continue;
-        
-        // 分割键值对
-        *equals = '\0';
         key = trim(line);
-        value = trim(equals + 1);
+
+        // 跳过注释行和空行
+        if (key[0] == '#' || key[0] == '\0') continue;
+
+        // 配置段：config schedule 的选项写入静音时段条目，其余配置段按主配置处理
+        if (strncmp(key, "config", 6) == 0 && isspace((unsigned char)key[6])) {
+            if (entry) schedule_seal(entry, entry_end, entry_bad);
+            entry = NULL;
+            char* type = trim(key + 6);
+            if (strncmp(type, "schedule", 8) == 0 && (type[8] == '\0' || isspace((unsigned char)type[8]))) {
+                if (schedule_count >= SCHEDULE_MAX) {
+                    fprintf(stderr, "Too many schedule sections, only %d are used\n", SCHEDULE_MAX);
+                    entry = &schedule_ignored;
+                } else {
+                    entry = &schedule[schedule_count++];
+                }
+                *entry = (ScheduleEntry){ .enabled = 1, .days = 0x7f, .max_speed = -1, .max_rpm = -1 };
+                entry_end = 0;
+                entry_bad = 0;
+            }
+            continue;
+        }
+
+        if ((strncmp(key, "option", 6) == 0 && isspace((unsigned char)key[6])) ||
+            (strncmp(key, "list", 4) == 0 && isspace((unsigned char)key[4]))) {
+            // UCI格式：option key 'value' 或 list key 'value'（列表项逐条追加）
+            key = trim(key + (key[0] == 'o' ? 6 : 4));
+            value = key;
+            while (*value && !isspace((unsigned char)*value)) value++;
+            if (*value) *value++ = '\0';
+            value = trim(value);
+        } else {
+            // 查找等号
+            char* equals = strchr(key, '=');
+            if (equals == NULL) continue;
+
+            // 分割键值对
+            *equals = '\0';
+            key = trim(key);
+            value = trim(equals + 1);
+        }
         
-        // 去除值两端的单引号
-        if (value[0] == '\'') {
+        // 去除值两端的引号
+        if (value[0] == '\'' || value[0] == '"') {
+            char quote = value[0];
             value++;
-            char* end_quote = strrchr(value, '\'');
+            char* end_quote = strrchr(value, quote);
             if (end_quote) *end_quote = '\0';
         }
         
+        if (entry) {
+            if (strcmp(key, "enabled") == 0) {
+                entry->enabled = atoi(value);
+            } else if (strcmp(key, "days") == 0) {
+                entry->days = parse_days(value);
+            } else if (strcmp(key, "start") == 0 || strcmp(key, "end") == 0) {
+                int minute = parse_time_of_day(value);
+                if (minute < 0) {
+                    fprintf(stderr, "Warning: invalid schedule %s time '%s' (HH:MM), schedule ignored\n", key, value);
+                    entry_bad = 1;
+                } else if (key[0] == 's') {
+                    entry->start = minute;
+                } else {
+                    entry_end = minute;
+                }
+            } else if (strcmp(key, "max_speed") == 0) {
+                entry->max_speed = atoi(value);
+            } else if (strcmp(key, "max_rpm") == 0) {
+                entry->max_rpm = atoi(value);
+            } else if (strcmp(key, "temp_offset") == 0) {
+                entry->temp_offset = atoi(value);
+            } else if (strcmp(key, "controller") == 0) {
+                snprintf(entry->controller, sizeof(entry->controller), "%s", value);
+            }
+            continue;
+        }
+
         // 根据键名设置对应的配置值
         if (strcmp(key, "thermal_file") == 0) {
             snprintf(thermal_file, sizeof(thermal_file), "%s", value);
@@ -122,13 +426,154 @@ static int parse_config_file(const char* config_file) {
             Ki = atof(value);
         } else if (strcmp(key, "Kd") == 0) {
             Kd = atof(value);
+        } else if (strcmp(key, "Kb") == 0) {
+            Kb = atof(value);
         } else if (strcmp(key, "log_interval") == 0) {
-            log_interval = atoi(value);
+            __atomic_store_n(&log_interval, atoi(value), __ATOMIC_RELAXED);
+        } else if (strcmp(key, "tsdb_size") == 0) {
+            __atomic_store_n(&tsdb_size, atoi(value), __ATOMIC_RELAXED);
         } else if (strcmp(key, "pid_interval") == 0) {
             pid_interval = atoi(value);
+        } else if (strcmp(key, "stall_timeout") == 0) {
+            stall_timeout = atoi(value);
+        } else if (strcmp(key, "kick_time") == 0) {
+            kick_time = atoi(value);
+        } else if (strcmp(key, "stall_alarm") == 0) {
+            stall_alarm = atoi(value);
+        } else if (strcmp(key, "pwm_slew_up") == 0) {
+            pwm_slew_up = atof(value);
+        } else if (strcmp(key, "pwm_slew_down") == 0) {
+            pwm_slew_down = atof(value);
+        } else if (strcmp(key, "pwm_deadband") == 0) {
+            pwm_deadband = atoi(value);
+        } else if (strcmp(key, "pwm_dwell") == 0) {
+            pwm_dwell = atoi(value);
+        } else if (strcmp(key, "zero_rpm") == 0) {
+            zero_rpm = atoi(value);
+        } else if (strcmp(key, "zero_rpm_stop_temp") == 0) {
+            zero_rpm_stop_temp = atof(value);
+        } else if (strcmp(key, "zero_rpm_start_temp") == 0) {
+            zero_rpm_start_temp = atof(value);
+        } else if (strcmp(key, "zero_rpm_min_off") == 0) {
+            zero_rpm_min_off = atoi(value);
+        } else if (strcmp(key, "zero_rpm_min_on") == 0) {
+            zero_rpm_min_on = atoi(value);
+        } else if (strcmp(key, "schedule_override_temp") == 0) {
+            schedule_override_temp = atoi(value);
+        } else if (strcmp(key, "cascade") == 0) {
+            cascade = atoi(value);
+        } else if (strcmp(key, "max_rpm") == 0) {
+            max_rpm = atoi(value);
+        } else if (strcmp(key, "rpm_Kp") == 0) {
+            rpm_Kp = atof(value);
+        } else if (strcmp(key, "rpm_Ki") == 0) {
+            rpm_Ki = atof(value);
+        } else if (strcmp(key, "rpm_interval") == 0) {
+            rpm_interval = atoi(value);
+        } else if (strcmp(key, "calibrate") == 0) {
+            calibrate = atoi(value);
+        } else if (strcmp(key, "calibrate_settle") == 0) {
+            calibrate_settle = atoi(value);
+        } else if (strcmp(key, "filter_median") == 0) {
+            filter_median = atoi(value);
+        } else if (strcmp(key, "filter_type") == 0) {
+            snprintf(filter_type, sizeof(filter_type), "%s", value);
+        } else if (strcmp(key, "filter_alpha") == 0) {
+            filter_alpha = atof(value);
+        } else if (strcmp(key, "filter_cutoff") == 0) {
+            filter_cutoff = atof(value);
+        } else if (strcmp(key, "oversample") == 0) {
+            oversample = atoi(value);
+        } else if (strcmp(key, "sensor") == 0) {
+            // 格式：路径[:偏移[:权重]]
+            if (sensor_count < SENSOR_MAX) {
+                float offset = 0.0, weight = 1.0;
+                char* sep = strchr(value, ':');
+                if (sep) {
+                    *sep = '\0';
+                    sscanf(sep + 1, "%f:%f", &offset, &weight);
+                }
+                snprintf(sensor_path[sensor_count], sizeof(sensor_path[0]), "%s", value);
+                sensor_offset[sensor_count] = offset;
+                sensor_weight[sensor_count] = weight > 0 ? weight : 1.0;
+                sensor_count++;
+            }
+        } else if (strcmp(key, "sensor_fusion") == 0) {
+            snprintf(sensor_fusion, sizeof(sensor_fusion), "%s", value);
+        } else if (strcmp(key, "fusion_q") == 0) {
+            fusion_q = atof(value);
+        } else if (strcmp(key, "fusion_r") == 0) {
+            fusion_r = atof(value);
+        } else if (strcmp(key, "io_uring") == 0) {
+            io_uring_enable = atoi(value);
+        } else if (strcmp(key, "sensor_async") == 0) {
+            sensor_async = atoi(value);
+        } else if (strcmp(key, "failsafe_reads") == 0) {
+            failsafe_reads = atoi(value);
+        } else if (strcmp(key, "failsafe_speed") == 0) {
+            failsafe_speed = atoi(value);
+        } else if (strcmp(key, "stale_timeout") == 0) {
+            stale_timeout = atoi(value);
+        } else if (strcmp(key, "critical_temp") == 0) {
+            critical_temp = atoi(value);
+        } else if (strcmp(key, "autotune") == 0) {
+            autotune = atoi(value);
+        } else if (strcmp(key, "autotune_rule") == 0) {
+            snprintf(autotune_rule, sizeof(autotune_rule), "%s", value);
+        } else if (strcmp(key, "autotune_low") == 0) {
+            autotune_low = atof(value);
+        } else if (strcmp(key, "autotune_max_temp") == 0) {
+            autotune_max_temp = atoi(value);
+        } else if (strcmp(key, "autotune_timeout") == 0) {
+            autotune_timeout = atoi(value);
+        } else if (strcmp(key, "model_adapt") == 0) {
+            model_adapt = atoi(value);
+        } else if (strcmp(key, "model_adapt_range") == 0) {
+            model_adapt_range = atof(value);
+        } else if (strcmp(key, "ff_cpu_gain") == 0) {
+            ff_cpu_gain = atof(value);
+        } else if (strcmp(key, "ff_cpu_source") == 0) {
+            snprintf(ff_cpu_source, sizeof(ff_cpu_source), "%s", value);
+        } else if (strcmp(key, "ff_cpu_learn") == 0) {
+            ff_cpu_learn = atoi(value);
+        } else if (strcmp(key, "ff_cpu_learn_rate") == 0) {
+            ff_cpu_learn_rate = atof(value);
+        } else if (strcmp(key, "ff_net_iface") == 0) {
+            if (ff_net_iface_count < NET_IFACE_MAX) {
+                snprintf(ff_net_iface[ff_net_iface_count++], sizeof(ff_net_iface[0]), "%s", value);
+            }
+        } else if (strcmp(key, "ff_net_metric") == 0) {
+            snprintf(ff_net_metric, sizeof(ff_net_metric), "%s", value);
+        } else if (strcmp(key, "ff_net_point") == 0) {
+            // 格式：流量:输出，按流量递增排列
+            if (ff_net_points < FF_TABLE_MAX &&
+                sscanf(value, "%f:%f", &ff_net_rate[ff_net_points], &ff_net_output[ff_net_points]) == 2) {
+                ff_net_points++;
+            }
+        } else if (strcmp(key, "ff_airtime_file") == 0) {
+            if (ff_airtime_count < AIRTIME_MAX) {
+                snprintf(ff_airtime_file[ff_airtime_count++], sizeof(ff_airtime_file[0]), "%s", value);
+            }
+        } else if (strcmp(key, "ff_airtime_gain") == 0) {
+            ff_airtime_gain = atof(value);
+        } else if (strcmp(key, "controller") == 0) {
+            snprintf(controller, sizeof(controller), "%s", value);
+        } else if (strcmp(key, "curve_point") == 0) {
+            // 格式：温度:PWM，按温度递增排列
+            if (curve_points < CURVE_POINTS_MAX &&
+                sscanf(value, "%f:%d", &curve_temp[curve_points], &curve_pwm[curve_points]) == 2) {
+                curve_points++;
+            }
+        } else if (strcmp(key, "curve_hyst_rise") == 0) {
+            curve_hyst_rise = atof(value);
+        } else if (strcmp(key, "curve_hyst_fall") == 0) {
+            curve_hyst_fall = atof(value);
+        } else if (strcmp(key, "bang_hyst") == 0) {
+            bang_hyst = atof(value);
         }
     }
     
+    if (entry) schedule_seal(entry, entry_end, entry_bad);
     fclose(fp);
     return 0;
 }
@@ -163,23 +608,11 @@ static int read_file(const char* path ,char* result ,size_t size) {
     return 0;
 }
 
-/**
- * 向指定文件写入内容
- * @param path 文件路径
- * @param buf 要写入的数据缓冲区
- * @param len 数据长度
- * @return 成功写入的字节数，失败返回0
- */
-static size_t write_file(const char* path ,char* buf ,size_t len) {
-    FILE* fp = NULL;
-    size_t size = 0;
-    fp = fopen(path ,"w+");
-    if (fp == NULL) {
-        return 0;
-    }
-    size = fwrite(buf ,len ,1 ,fp);
-    fclose(fp);
-    return size;
+// 单调时钟（秒），不受系统时间调整影响
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 /**
@@ -188,222 +621,3678 @@ static size_t write_file(const char* path ,char* buf ,size_t len) {
  * @param div 温度系数，用于将原始值转换为摄氏度
  * @return 温度值（摄氏度），读取失败返回-1
  */
-float get_temperature(char* thermal_file ,int div) {
+float get_temperature(const char* thermal_file ,int div) {
     char buf[8] = { 0 };
     if (read_file(thermal_file ,buf ,0) == 0) {
-        return (float)atoi(buf) / div;
+        // 内容不是数字（如驱动返回错误信息）时按读取失败处理
+        char* end;
+        long value = strtol(buf, &end, 10);
+        if (end != buf) {
+            return (float)value / div;
+        }
     }
     return -1.0;
 }
 
 /**
- * 设置风扇转速
- * @param fan_speed_set 风扇速度值（0-255）
- * @param fan_pwm_file 风扇PWM控制文件路径
- * @return 成功写入的字节数，失败返回0
+ * sysfs属性批量读写
+ * 文件保持打开，每次从偏移0处读写（sysfs在偏移0处读取时重新生成数值）；
+ * 启用 io_uring 时注册文件和固定缓冲区，一次系统调用提交并等待全部读取（或写入），
+ * 内核不支持 io_uring 时逐个 pread/pwrite。
+ * 打开或读写失败的属性单独重新打开，不影响其他属性和 io_uring
  */
-int set_fanspeed(int fan_speed_set, char* fan_pwm_file) {
-    char buf[8] = { 0 };
-    sprintf(buf, "%d\n", fan_speed_set);
-    return write_file(fan_pwm_file, buf, strlen(buf));
+#ifdef HAVE_IO_URING
+typedef struct {
+    int fd;                         // io_uring 文件描述符，-1表示未使用
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+} IoUring;
+#endif
+
+typedef struct {
+    int opened;                             // 是否已打开
+    int count;                              // 属性个数
+    const char* paths[SYSFS_BATCH_MAX];     // 属性文件（由调用方保证有效）
+    int fd[SYSFS_BATCH_MAX];                // 文件描述符，-1表示打开失败（下次读写前重新打开）
+    char buf[SYSFS_BATCH_MAX][SYSFS_BUF];   // 读写缓冲区（io_uring 固定缓冲区）
+    int len[SYSFS_BATCH_MAX];               // 最近一次读写的字节数，失败为-1
+    int use_uring;                          // 是否尝试使用 io_uring
+    unsigned long syscalls;                 // 读写和重新打开发出的系统调用数（统计用）
+#ifdef HAVE_IO_URING
+    IoUring ring;
+#endif
+} SysfsBatch;
+
+#ifdef HAVE_IO_URING
+static void io_uring_close(IoUring *ring) {
+    if (ring->fd < 0) return;
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_size);
+    if (ring->sq_ptr) munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
 }
 
-/**
- * 读取当前风扇速度
- * @param fan_speed_file 风扇速度读取文件路径
- * @return 风扇速度（RPM），读取失败返回-1
- */
-int get_fanspeed(char* fan_speed_file) {
-    char buf[8] = { 0 };
-    if (read_file(fan_speed_file, buf, 0) == 0) {
-        return atoi(buf);
+// 创建 io_uring 并注册文件和缓冲区，失败返回-1
+// 打开失败的文件以-1占位注册，重新打开后用 IORING_REGISTER_FILES_UPDATE 单独替换
+static int io_uring_open(IoUring *ring, SysfsBatch *b) {
+    struct io_uring_params p;
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+    ring->fd = syscall(__NR_io_uring_setup, b->count, &p);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return -1;
     }
-    return -1;
+
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+        ring->cq_size = ring->sq_size;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = NULL;
+        io_uring_close(ring);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            ring->cq_ptr = NULL;
+            io_uring_close(ring);
+            return -1;
+        }
+    }
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        io_uring_close(ring);
+        return -1;
+    }
+
+    char *sq = ring->sq_ptr, *cq = ring->cq_ptr;
+    ring->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    // 注册文件和固定缓冲区，提交时不再逐次查找文件和映射内存
+    struct iovec iov[SYSFS_BATCH_MAX];
+    for (int i = 0; i < b->count; i++) {
+        iov[i].iov_base = b->buf[i];
+        iov[i].iov_len = SYSFS_BUF;
+    }
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, b->fd, b->count) < 0 ||
+        syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iov, b->count) < 0) {
+        io_uring_close(ring);
+        return -1;
+    }
+    return 0;
+}
+
+// 替换一个已注册的文件，失败返回-1
+static int io_uring_update_file(IoUring *ring, int index, int fd) {
+    struct io_uring_files_update up;
+    memset(&up, 0, sizeof(up));
+    up.offset = index;
+    up.fds = (unsigned long)&fd;
+    return syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1 ? 0 : -1;
 }
 
 /**
- * 计算风扇转速
+ * 一次提交所有已打开属性的读取或写入并等待完成，结果写入 b->len
+ * @param opcode IORING_OP_READ_FIXED 或 IORING_OP_WRITE_FIXED（写入长度取自 b->len）
+ * @return 成功返回0，失败返回-1（调用方改用 pread/pwrite）
  */
-// PID 控制器参数
-typedef struct {
-    float Kp;
-    float Ki;
-    float Kd;
-    float integral;
-    float prev_error;
-} PIDController;
+static int io_uring_submit_all(IoUring *ring, SysfsBatch *b, int opcode) {
+    unsigned tail = *ring->sq_tail;
+    unsigned mask = *ring->sq_mask;
+    int submit = 0;
+    for (int i = 0; i < b->count; i++) {
+        if (b->fd[i] < 0) {
+            b->len[i] = -1;
+            continue;
+        }
+        unsigned idx = tail & mask;
+        struct io_uring_sqe *sqe = &ring->sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = i;
+        sqe->addr = (unsigned long)b->buf[i];
+        sqe->len = opcode == IORING_OP_READ_FIXED ? SYSFS_BUF - 1 : (unsigned)b->len[i];
+        sqe->off = 0;
+        sqe->buf_index = i;
+        sqe->user_data = i;
+        ring->sq_array[idx] = idx;
+        tail++;
+        submit++;
+    }
+    if (submit == 0) return 0;
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
 
-// 初始化 PID 控制器
-void PID_Init(PIDController *pid, float Kp, float Ki, float Kd) {
-    pid->Kp = Kp;
-    pid->Ki = Ki;
-    pid->Kd = Kd;
-    pid->integral = 0;
-    pid->prev_error = 0;
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->fd, submit, submit, IORING_ENTER_GETEVENTS, NULL, 0);
+        b->syscalls++;
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) return -1;
+
+    unsigned head = *ring->cq_head;
+    int done = 0;
+    while (done < submit && head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        if (cqe->user_data < (unsigned)b->count) {
+            b->len[cqe->user_data] = cqe->res >= 0 ? cqe->res : -1;
+        }
+        head++;
+        done++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return done == submit ? 0 : -1;
 }
+#endif
 
-// PID 计算
-float PID_Calculate(PIDController *pid, float setpoint, float actual_value, float dt) {
-    // 误差计算：实际温度 - 目标温度
-    // 当实际温度高于目标温度时，误差为正，需要增加风扇速度
-    float error = actual_value - setpoint;
-    
-    // 积分项计算，但限制积分项的范围防止过度累积
-    pid->integral += error * dt;
-    // 限制积分项在合理范围内，防止过度累积
-    if (pid->integral > 100.0) pid->integral = 100.0;
-    if (pid->integral < 0.0) pid->integral = 0.0;
-    
-    float derivative = (error - pid->prev_error) / dt;
-    pid->prev_error = error;
-    
-    return pid->Kp * error + pid->Ki * pid->integral + pid->Kd * derivative;
-}
-
-// 计算风扇转速
-int calculate_speed_set(float current_temp, int max_temp, int target_temp, int max_speed, int min_speed) {
-    // 使用 PID 控制器计算风扇转速
-    static PIDController pid;
-    static int initialized = 0;
-    if (!initialized) {
-        PID_Init(&pid, Kp, Ki, Kd); // 使用配置的 PID 参数
-        initialized = 1;
-    }
-
-    // 使用配置的目标温度作为 PID 控制的目标值
-    float setpoint = (float)target_temp;
-    float output = PID_Calculate(&pid, setpoint, current_temp, 1.0); // 计算 PID 输出
-
-    // 当当前温度低于目标温度时，PID输出应该逐渐减小到0
-    // 当PID输出为0时，风扇应该完全停止
-    float pid_output;
-    if (output < 0) {
-        pid_output = 0.0; // 最低输出为0，风扇停止
-    } else if (output > 100.0) {
-        pid_output = 100.0; // 最高输出
-    } else {
-        pid_output = output; // 直接使用输出值
+// 关闭所有文件
+void sysfs_batch_close(SysfsBatch *b) {
+    if (!b->opened) return;
+#ifdef HAVE_IO_URING
+    io_uring_close(&b->ring);
+#endif
+    for (int i = 0; i < b->count; i++) {
+        if (b->fd[i] >= 0) close(b->fd[i]);
+        b->fd[i] = -1;
     }
+    b->opened = 0;
+}
 
-    // 计算百分比 (0-1.0)
-    float percentage = pid_output / 100.0;
+/**
+ * 打开一组sysfs属性
+ * @param b 批量读写状态
+ * @param paths 属性文件（读写期间必须保持有效）
+ * @param count 属性个数（不超过 SYSFS_BATCH_MAX）
+ * @param flags 打开方式（O_RDONLY 或 O_WRONLY）
+ * @param use_uring 是否尝试使用 io_uring
+ */
+void sysfs_batch_open(SysfsBatch *b, const char* const* paths, int count, int flags, int use_uring) {
+    sysfs_batch_close(b);
+    memset(b, 0, sizeof(*b));
+    b->count = count < SYSFS_BATCH_MAX ? count : SYSFS_BATCH_MAX;
+    b->use_uring = use_uring;
+    for (int i = 0; i < b->count; i++) {
+        b->paths[i] = paths[i];
+        b->fd[i] = open(paths[i], flags | O_CLOEXEC);
+        b->syscalls++;
+    }
+    b->opened = 1;
+#ifdef HAVE_IO_URING
+    b->ring.fd = -1;
+    if (use_uring && io_uring_open(&b->ring, b) != 0) {
+        fprintf(stderr, "io_uring not available, using pread/pwrite\n");
+        b->use_uring = 0;
+    }
+#else
+    (void)use_uring;
+#endif
+}
 
-    // 根据百分比计算风扇速度
-    // 当percentage为0时，风扇速度为0（停止）
-    // 当percentage大于0时，风扇速度从min_speed开始
-    float fan_speed_float;
-    if (percentage <= 0.0) {
-        fan_speed_float = 0.0; // PID输出为0时风扇停止
-    } else {
-        fan_speed_float = min_speed + (percentage * (max_speed - min_speed));
+// 重新打开失败的属性，只处理 fd 为-1的文件
+static void sysfs_batch_reopen(SysfsBatch *b, int flags) {
+    for (int i = 0; i < b->count; i++) {
+        if (b->fd[i] >= 0) continue;
+        b->fd[i] = open(b->paths[i], flags | O_CLOEXEC);
+        b->syscalls++;
+#ifdef HAVE_IO_URING
+        if (b->fd[i] >= 0 && b->ring.fd >= 0 && io_uring_update_file(&b->ring, i, b->fd[i]) != 0) {
+            io_uring_close(&b->ring);
+            b->use_uring = 0;
+        }
+#endif
     }
-    
-    int fan_speed_set = (int)(fan_speed_float + 0.5); // 四舍五入
+}
 
-    // 限制风扇速度在有效范围内
-    if (fan_speed_set > max_speed) {
-        fan_speed_set = max_speed;
-    } else if (fan_speed_set < 0) {
-        fan_speed_set = 0; // 确保不会出现负值
+// 读写失败的属性关闭文件，下次读写前单独重新打开（设备可能被重新加载）
+static void sysfs_batch_drop_failed(SysfsBatch *b) {
+    for (int i = 0; i < b->count; i++) {
+        if (b->len[i] >= 0 || b->fd[i] < 0) continue;
+#ifdef HAVE_IO_URING
+        if (b->ring.fd >= 0 && io_uring_update_file(&b->ring, i, -1) != 0) {
+            io_uring_close(&b->ring);
+            b->use_uring = 0;
+        }
+#endif
+        close(b->fd[i]);
+        b->fd[i] = -1;
     }
-    
-    return fan_speed_set;
 }
 
-// 记录温度日志
-void log_temperature(float current_temp) {
-    // 确保 /tmp/log/ 目录存在
-    mkdir("/tmp/log", 0755);
+/**
+ * 读取全部属性，结果在 b->buf（以'\0'结尾）和 b->len 中
+ */
+void sysfs_batch_read(SysfsBatch *b) {
+    sysfs_batch_reopen(b, O_RDONLY);
 
-    // 读取现有日志内容
-    FILE *log_file = fopen("/tmp/log/log.fancontrol_temp", "r");
-    char **lines = NULL;
-    size_t line_count = 0;
-    char line[256];
-    
-    if (log_file) {
-        // 读取所有现有行
-        while (fgets(line, sizeof(line), log_file) != NULL) {
-            lines = realloc(lines, (line_count + 1) * sizeof(char*));
-            lines[line_count] = strdup(line);
-            line_count++;
+    int done = 0;
+#ifdef HAVE_IO_URING
+    if (b->ring.fd >= 0) {
+        done = io_uring_submit_all(&b->ring, b, IORING_OP_READ_FIXED) == 0;
+        if (!done) {
+            io_uring_close(&b->ring);
+            b->use_uring = 0;
         }
-        fclose(log_file);
     }
+#endif
+    for (int i = 0; i < b->count && !done; i++) {
+        b->len[i] = -1;
+        if (b->fd[i] < 0) continue;
+        b->len[i] = pread(b->fd[i], b->buf[i], SYSFS_BUF - 1, 0);
+        b->syscalls++;
+    }
+    sysfs_batch_drop_failed(b);
+    for (int i = 0; i < b->count; i++) {
+        b->buf[i][b->len[i] < 0 ? 0 : b->len[i]] = '\0';
+    }
+}
 
-    // 生成新的日志行（最新的在最前面）
-    time_t now;
-    time(&now);
-    char time_str[20];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    char new_line[256];
-    snprintf(new_line, sizeof(new_line), "[%s] %.1f\n", time_str, current_temp);
+/**
+ * 写入全部属性
+ * @param values 各属性的值
+ * @return 写入成功的属性个数
+ */
+int sysfs_batch_write(SysfsBatch *b, const int *values) {
+    sysfs_batch_reopen(b, O_WRONLY);
+    for (int i = 0; i < b->count; i++) {
+        b->len[i] = snprintf(b->buf[i], SYSFS_BUF, "%d\n", values[i]);
+    }
 
-    // 根据温度记录间隔计算1小时最多记录的条目数
-    // 1小时 = 3600秒，除以记录间隔得到最大条目数
-    const size_t max_lines = (log_interval > 0) ? (3600 / log_interval) : 360;
-    
-    // 重新打开文件写入（最新的在最前面）
-    log_file = fopen("/tmp/log/log.fancontrol_temp", "w");
-    if (log_file) {
-        // 先写入新记录（最新的在最前面）
-        fputs(new_line, log_file);
-        
-        // 然后写入现有记录，但不超过最大限制
-        size_t lines_to_write = (line_count < max_lines - 1) ? line_count : max_lines - 1;
-        for (size_t i = 0; i < lines_to_write; i++) {
-            fputs(lines[i], log_file);
-            free(lines[i]);
-        }
-        
-        // 释放剩余的内存
-        for (size_t i = lines_to_write; i < line_count; i++) {
-            free(lines[i]);
-        }
-        
-        if (lines) free(lines);
-        fclose(log_file);
-    } else {
-        // 如果写入失败，释放内存
-        for (size_t i = 0; i < line_count; i++) {
-            free(lines[i]);
+    int done = 0;
+#ifdef HAVE_IO_URING
+    if (b->ring.fd >= 0) {
+        done = io_uring_submit_all(&b->ring, b, IORING_OP_WRITE_FIXED) == 0;
+        if (!done) {
+            io_uring_close(&b->ring);
+            b->use_uring = 0;
         }
-        if (lines) free(lines);
     }
+#endif
+    for (int i = 0; i < b->count && !done; i++) {
+        int want = snprintf(b->buf[i], SYSFS_BUF, "%d\n", values[i]);
+        b->len[i] = -1;
+        if (b->fd[i] < 0) continue;
+        b->len[i] = pwrite(b->fd[i], b->buf[i], want, 0) == want ? want : -1;
+        b->syscalls++;
+    }
+    sysfs_batch_drop_failed(b);
+
+    int ok = 0;
+    for (int i = 0; i < b->count; i++) {
+        if (b->len[i] > 0) ok++;
+    }
+    return ok;
 }
 
 /**
- * 判断文件是否存在方法
+ * 传感器预滤波器
+ * 中值滤波剔除单点异常值，之后做EMA或二阶巴特沃斯(biquad)低通
+ * 状态全部保存在固定大小的环形缓冲区中，不做动态分配
  */
-static int file_exist(const char* name) {
-    struct stat buffer;
-    return stat(name ,&buffer);
+typedef enum {
+    FILTER_NONE = 0,
+    FILTER_EMA,
+    FILTER_BIQUAD,
+} FilterType;
+
+typedef struct {
+    int median;                         // 中值窗口大小
+    float window[FILTER_MEDIAN_MAX];    // 中值滤波环形缓冲区
+    int pos;                            // 下一个写入位置
+    int count;                          // 已有样本数
+    FilterType type;                    // 低通类型
+    float alpha;                        // EMA系数
+    float b0, b1, b2, a1, a2;           // biquad系数
+    float x1, x2, y1, y2;               // biquad状态
+    float y;                            // 上一次输出
+    int primed;                         // 是否已用第一个样本初始化
+} SensorFilter;
+
+/**
+ * 按当前配置初始化滤波器
+ * @param f 滤波器
+ * @param sample_rate 采样率（Hz）
+ */
+void sensor_filter_init(SensorFilter *f, float sample_rate) {
+    memset(f, 0, sizeof(*f));
+
+    f->median = filter_median;
+    if (f->median < 1) f->median = 1;
+    if (f->median > FILTER_MEDIAN_MAX) f->median = FILTER_MEDIAN_MAX;
+    if (f->median % 2 == 0) f->median--;
+
+    if (strcmp(filter_type, "ema") == 0) {
+        f->type = FILTER_EMA;
+        f->alpha = filter_alpha;
+        if (f->alpha <= 0.0 || f->alpha > 1.0) f->alpha = 1.0;
+    } else if (strcmp(filter_type, "biquad") == 0 && filter_cutoff > 0.0 && filter_cutoff < sample_rate / 2) {
+        // 双线性变换，Q=1/sqrt(2)
+        f->type = FILTER_BIQUAD;
+        float k = tanf(M_PI * filter_cutoff / sample_rate);
+        float q = 0.70710678f;
+        float norm = 1.0f / (1.0f + k / q + k * k);
+        f->b0 = k * k * norm;
+        f->b1 = 2.0f * f->b0;
+        f->b2 = f->b0;
+        f->a1 = 2.0f * (k * k - 1.0f) * norm;
+        f->a2 = (1.0f - k / q + k * k) * norm;
+    } else {
+        f->type = FILTER_NONE;
+    }
 }
 
 /**
- *  信号处理函数
+ * 输入一个样本并返回滤波后的值
  */
-void handle_termination(int signum) {
-    // 设置风扇转速为 0
-    set_fanspeed(0 ,fan_pwm_file);
-    exit(EXIT_SUCCESS); // 优雅地退出程序
+float sensor_filter_update(SensorFilter *f, float x) {
+    // 中值滤波：复制窗口后插入排序取中值
+    if (f->median > 1) {
+        f->window[f->pos] = x;
+        f->pos = (f->pos + 1) % f->median;
+        if (f->count < f->median) f->count++;
+
+        float sorted[FILTER_MEDIAN_MAX];
+        for (int i = 0; i < f->count; i++) {
+            float v = f->window[i];
+            int j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        x = sorted[f->count / 2];
+    }
+
+    // 第一个样本直接作为初始状态，避免启动瞬态
+    if (!f->primed) {
+        f->x1 = f->x2 = f->y1 = f->y2 = f->y = x;
+        f->primed = 1;
+        return x;
+    }
+
+    switch (f->type) {
+        case FILTER_EMA:
+            f->y += f->alpha * (x - f->y);
+            break;
+        case FILTER_BIQUAD:
+            f->y = f->b0 * x + f->b1 * f->x1 + f->b2 * f->x2 - f->a1 * f->y1 - f->a2 * f->y2;
+            f->x2 = f->x1;
+            f->x1 = x;
+            f->y2 = f->y1;
+            f->y1 = f->y;
+            break;
+        default:
+            f->y = x;
+            break;
+    }
+    return f->y;
 }
 
 /**
- * 注册信号处理函数
+ * 过采样读取温度：在 OVERSAMPLE_SPAN_MS 内均匀读取多次取平均
+ * 对1°C分辨率的传感器，利用读数抖动获得更细的分辨率
+ * @return 温度值（摄氏度），全部读取失败返回-1
  */
-void register_signal_handlers( ) {
-    signal(SIGINT, handle_termination);
-    signal(SIGTERM, handle_termination);
+float get_temperature_oversampled(char* thermal_file, int div, int n) {
+    if (n <= 1) {
+        return get_temperature(thermal_file, div);
+    }
+
+    float sum = 0.0;
+    int valid = 0;
+    for (int i = 0; i < n; i++) {
+        float t = get_temperature(thermal_file, div);
+        if (t != -1.0) {
+            sum += t;
+            valid++;
+        }
+        if (i < n - 1) usleep(OVERSAMPLE_SPAN_MS * 1000 / n);
+    }
+    return valid > 0 ? sum / valid : -1.0;
 }
 
 /**
- * 主函数
+ * 传感器健康状态
+ * 读取失败或超出量程的值不送入滤波器和控制器；连续失败或数值长时间不变时进入失效保护
  */
-int main(int argc, char* argv[]) {
-    // 解析命令行选项
-    int opt;
-    while ((opt = getopt(argc, argv, "T:F:S:s:t:m:d:D:v:")) != -1) {
+typedef struct {
+    int failures;       // 连续失败次数
+    float last_raw;     // 上一次有效读数
+    double changed;     // 读数上一次变化的时间（单调时钟，秒）
+    int failsafe;       // 是否处于失效保护
+} SensorHealth;
+
+/**
+ * 检查一次温度读数
+ * @param h 健康状态
+ * @param raw 读数，读取失败时为-1.0
+ * @param now 当前时间（单调时钟，秒）
+ * @return 读数可用返回1，否则返回0
+ */
+int sensor_health_update(SensorHealth *h, float raw, double now) {
+    int valid = raw != -1.0 && raw > -40.0 && raw < MAX_TEMP + 30;
+    int stale = 0;
+
+    if (valid) {
+        h->failures = 0;
+        if (raw != h->last_raw || h->changed == 0) {
+            h->last_raw = raw;
+            h->changed = now;
+        } else if (stale_timeout > 0 && now - h->changed >= stale_timeout) {
+            stale = 1;
+        }
+    } else {
+        h->failures++;
+    }
+
+    int failsafe = stale || (failsafe_reads > 0 && h->failures >= failsafe_reads);
+    if (failsafe && !h->failsafe) {
+        if (stale) {
+            fprintf(stderr, "Temperature stuck at %.1f°C for %d seconds, fan set to fail-safe PWM %d\n", raw, stale_timeout, failsafe_speed);
+        } else {
+            fprintf(stderr, "Temperature read failed %d times, fan set to fail-safe PWM %d\n", h->failures, failsafe_speed);
+        }
+    } else if (!failsafe && h->failsafe) {
+        fprintf(stderr, "Temperature sensor recovered\n");
+    }
+    h->failsafe = failsafe;
+    return valid && !stale;
+}
+
+/**
+ * 多传感器融合
+ * 每个传感器单独预滤波并检测失效，失效的传感器不参与融合；
+ * 融合方式为最大值（跟随最热的部件）、加权平均或标量卡尔曼滤波（输出估计值和方差）
+ */
+typedef struct {
+    const char* path;   // 传感器文件
+    float offset;       // 读数偏移（°C）
+    float weight;       // 权重
+    float value;        // 最近一次滤波后读数（已加偏移）
+    float last_raw;     // 上一次原始读数
+    double changed;     // 原始读数上一次变化的时间（单调时钟，秒）
+    int valid;          // 本次是否参与融合
+    int stuck;          // 读数停滞超过 stale_timeout
+    SensorFilter filter;
+} FusionSensor;
+
+typedef struct {
+    FusionSensor sensor[SENSOR_MAX];
+    int count;
+    float x;            // 卡尔曼估计值（°C）
+    float p;            // 卡尔曼估计方差（°C²）
+    int primed;         // 卡尔曼是否已初始化
+    float hottest;      // 本次未经滤波的最高读数（已加偏移），用于超温保护
+    SysfsBatch io;      // 同步读取时保持打开的传感器文件
+} SensorFusion;
+
+// 按当前配置初始化，没有配置 sensor 列表时使用 thermal_file
+void sensor_fusion_init(SensorFusion *fu) {
+    sysfs_batch_close(&fu->io);
+    memset(fu, 0, sizeof(*fu));
+    fu->count = sensor_count > 0 ? sensor_count : 1;
+    for (int i = 0; i < fu->count; i++) {
+        FusionSensor *s = &fu->sensor[i];
+        s->path = sensor_count > 0 ? sensor_path[i] : thermal_file;
+        s->offset = sensor_count > 0 ? sensor_offset[i] : 0.0;
+        s->weight = sensor_count > 0 ? sensor_weight[i] : 1.0;
+        sensor_filter_init(&s->filter, 1.0);
+    }
+}
+
+/**
+ * 同步读取一组传感器
+ * 过采样时各传感器交替读取，总耗时不随传感器数增加
+ * @param b 已打开的传感器文件
+ * @param raw 输出：各传感器读数，读取失败为-1.0
+ * @param samples 过采样次数
+ * @param div 温度系数
+ */
+static void sensor_read_all(SysfsBatch *b, float *raw, int samples, int div) {
+    float sum[SENSOR_MAX] = { 0 };
+    int reads[SENSOR_MAX] = { 0 };
+    int n = samples > 1 ? samples : 1;
+    int count = b->count;
+
+    for (int k = 0; k < n; k++) {
+        sysfs_batch_read(b);
+        for (int i = 0; i < count; i++) {
+            // 内容不是数字时按读取失败处理
+            char* end;
+            long value = strtol(b->buf[i], &end, 10);
+            if (b->len[i] > 0 && end != b->buf[i]) {
+                sum[i] += (float)value / div;
+                reads[i]++;
+            }
+        }
+        if (k < n - 1) usleep(OVERSAMPLE_SPAN_MS * 1000 / n);
+    }
+    for (int i = 0; i < count; i++) {
+        raw[i] = reads[i] > 0 ? sum[i] / reads[i] : -1.0;
+    }
+}
+
+/**
+ * 异步读取：每个传感器一个读取线程和一个最新值缓存槽，读取线程写、控制线程读
+ * 用序号（seqlock）保证读到的数值和时间戳属于同一次读取，双方都不加锁、不阻塞；
+ * 某个设备阻塞时只有它自己的缓存值过期。风扇转速（fan_speed_file）也由一个读取线程按内环周期读取，
+ * 放在最后一个缓存槽中，I2C风扇控制器的慢速读取同样不会阻塞控制循环。
+ * 重新加载配置时先唤醒并等待旧线程全部退出，再启动新线程，每个缓存槽始终只有一个写入者
+ */
+typedef struct {
+    uint32_t seq;           // 序号，奇数表示正在写入
+    uint32_t generation;    // 写入线程所属的代，重新加载配置后旧线程的写入被忽略
+    int32_t value;          // 读数（m°C），读取失败为INT32_MIN
+    uint32_t stamp;         // 读取完成时间（单调时钟，毫秒）
+} SensorSlot;
+
+typedef struct {
+    int index;                  // 缓存槽序号
+    uint32_t generation;        // 线程所属的代
+    int oversample;             // 过采样次数（启动时的配置副本）
+    int temp_div;               // 温度系数（启动时的配置副本），转速为1
+    int period_ms;              // 读取周期（毫秒）
+    char path[MAX_LENGTH];      // 传感器文件（线程私有副本）
+} SensorThreadArg;
+
+#define FAN_SLOT SENSOR_MAX     // 风扇转速的缓存槽
+
+static SensorSlot sensor_slots[SENSOR_MAX + 1];
+static uint32_t sensor_generation = 0;     // 当前代，线程发现代改变后退出
+static int sensor_thread_count = 0;         // 当前代的读取线程数
+static pthread_t sensor_threads[SENSOR_MAX + 1];
+static int fan_thread = 0;                  // 风扇转速是否由读取线程读取
+static pthread_mutex_t sensor_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sensor_wake;         // 代改变时唤醒休眠中的读取线程（单调时钟）
+static int sensor_wake_init = 0;
+
+static uint32_t monotonic_ms(void) {
+    return (uint32_t)(monotonic_seconds() * 1000.0);
+}
+
+static void sensor_slot_store(SensorSlot *slot, uint32_t generation, float value) {
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->generation, generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->value, value == -1.0 ? INT32_MIN : (int32_t)lroundf(value * 1000.0), __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->stamp, monotonic_ms(), __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// 读取缓存值，没有当前代的数据或超过 SENSOR_SLOT_MAX_AGE 未更新时返回-1.0
+static float sensor_slot_load(SensorSlot *slot) {
+    uint32_t seq1, seq2, generation, stamp;
+    int32_t value;
+    do {
+        seq1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        generation = __atomic_load_n(&slot->generation, __ATOMIC_RELAXED);
+        value = __atomic_load_n(&slot->value, __ATOMIC_RELAXED);
+        stamp = __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    } while ((seq1 & 1) || seq1 != seq2);
+
+    if (generation != __atomic_load_n(&sensor_generation, __ATOMIC_RELAXED) || value == INT32_MIN) return -1.0;
+    if ((uint32_t)(monotonic_ms() - stamp) > SENSOR_SLOT_MAX_AGE * 1000) return -1.0;
+    return value / 1000.0;
+}
+
+// 传感器读取线程：每个周期读取一次对应的文件，所属的代过期后退出
+static void* sensor_thread_main(void *arg) {
+    SensorThreadArg *ta = arg;
+    const char* path = ta->path;
+    SysfsBatch batch = { 0 };
+    sysfs_batch_open(&batch, &path, 1, O_RDONLY, 0);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (__atomic_load_n(&sensor_generation, __ATOMIC_RELAXED) == ta->generation) {
+        float raw;
+        sensor_read_all(&batch, &raw, ta->oversample, ta->temp_div);
+        if (__atomic_load_n(&sensor_generation, __ATOMIC_RELAXED) != ta->generation) break;
+        sensor_slot_store(&sensor_slots[ta->index], ta->generation, raw);
+
+        // 休眠到下一个周期，代改变时立即醒来
+        next.tv_nsec += (long)ta->period_ms * 1000000;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        pthread_mutex_lock(&sensor_lock);
+        while (sensor_generation == ta->generation &&
+               pthread_cond_timedwait(&sensor_wake, &sensor_lock, &next) == 0) {
+        }
+        pthread_mutex_unlock(&sensor_lock);
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec + 1) next = now;  // 读取阻塞过久时不补读
+    }
+    sysfs_batch_close(&batch);
+    free(ta);
+    return NULL;
+}
+
+/**
+ * 停止传感器读取线程（重新加载配置前调用）
+ * 唤醒休眠中的线程并等待全部退出；阻塞在设备上的线程要等本次读取返回
+ */
+void sensor_threads_stop(void) {
+    pthread_mutex_lock(&sensor_lock);
+    __atomic_add_fetch(&sensor_generation, 1, __ATOMIC_RELAXED);
+    if (sensor_wake_init) pthread_cond_broadcast(&sensor_wake);
+    pthread_mutex_unlock(&sensor_lock);
+    for (int i = 0; i < sensor_thread_count; i++) {
+        pthread_join(sensor_threads[i], NULL);
+    }
+    sensor_thread_count = 0;
+    fan_thread = 0;
+}
+
+/**
+ * 为每个传感器和风扇转速启动读取线程
+ * @return 成功返回0，失败返回-1（调用方改为同步读取）
+ */
+int sensor_threads_start(const SensorFusion *fu) {
+    uint32_t generation = __atomic_load_n(&sensor_generation, __ATOMIC_RELAXED);
+    if (!sensor_wake_init) {
+        pthread_condattr_t cattr;
+        pthread_condattr_init(&cattr);
+        pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+        pthread_cond_init(&sensor_wake, &cattr);
+        pthread_condattr_destroy(&cattr);
+        sensor_wake_init = 1;
+    }
+
+    // 信号只由主线程处理
+    sigset_t set, old;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    int ret = 0;
+    sensor_thread_count = 0;
+    int threads = fu->count + (fan_speed_file[0] != '\0');
+    for (int i = 0; i < threads; i++) {
+        SensorThreadArg *ta = malloc(sizeof(*ta));
+        if (ta == NULL) {
+            ret = -1;
+            break;
+        }
+        int fan = i == fu->count;
+        ta->index = fan ? FAN_SLOT : i;
+        ta->generation = generation;
+        ta->oversample = fan ? 1 : oversample;
+        ta->temp_div = fan ? 1 : temp_div;
+        // 转速按内环周期读取，串级模式以外每秒一次
+        ta->period_ms = fan && cascade ? rpm_interval : 1000;
+        snprintf(ta->path, sizeof(ta->path), "%s", fan ? fan_speed_file : fu->sensor[i].path);
+        if (pthread_create(&sensor_threads[i], NULL, sensor_thread_main, ta) != 0) {
+            free(ta);
+            ret = -1;
+            break;
+        }
+        sensor_thread_count++;
+        if (fan) fan_thread = 1;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (ret != 0) {
+        fprintf(stderr, "Cannot start sensor threads, reading sensors synchronously\n");
+        sensor_threads_stop();
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 读取所有传感器并融合
+ * 启用异步读取时只读取缓存值，不访问设备
+ * @param fu 融合状态
+ * @param now 当前时间（单调时钟，秒）
+ * @return 融合后的温度，所有传感器都失效时返回-1.0
+ */
+float sensor_fusion_read(SensorFusion *fu, double now) {
+    float raws[SENSOR_MAX];
+    if (sensor_thread_count > 0) {
+        for (int i = 0; i < fu->count; i++) {
+            raws[i] = sensor_slot_load(&sensor_slots[i]);
+        }
+    } else {
+        if (!fu->io.opened) {
+            const char* paths[SENSOR_MAX];
+            for (int i = 0; i < fu->count; i++) {
+                paths[i] = fu->sensor[i].path;
+            }
+            sysfs_batch_open(&fu->io, paths, fu->count, O_RDONLY, io_uring_enable);
+        }
+        sensor_read_all(&fu->io, raws, oversample, temp_div);
+    }
+
+    fu->hottest = -1000.0;
+    int valid = 0;
+    for (int i = 0; i < fu->count; i++) {
+        FusionSensor *s = &fu->sensor[i];
+        float raw = raws[i];
+        s->valid = raw != -1.0 && raw > -40.0 && raw < MAX_TEMP + 30;
+        if (!s->valid) continue;
+
+        // 读数长时间不变的传感器视为失效
+        if (raw != s->last_raw || s->changed == 0) {
+            s->last_raw = raw;
+            s->changed = now;
+            s->stuck = 0;
+        } else if (stale_timeout > 0 && now - s->changed >= stale_timeout) {
+            if (!s->stuck) {
+                fprintf(stderr, "Sensor %s stuck at %.1f°C for %d seconds, ignored\n", s->path, raw, stale_timeout);
+                s->stuck = 1;
+            }
+            s->valid = 0;
+            continue;
+        }
+        s->value = sensor_filter_update(&s->filter, raw) + s->offset;
+        if (raw + s->offset > fu->hottest) fu->hottest = raw + s->offset;
+        valid++;
+    }
+    if (valid == 0) return -1.0;
+
+    // 单个传感器时直接返回其滤波后的读数
+    if (fu->count == 1) return fu->sensor[0].value;
+
+    if (strcmp(sensor_fusion, "mean") == 0) {
+        float wsum = 0.0, total = 0.0;
+        for (int i = 0; i < fu->count; i++) {
+            if (!fu->sensor[i].valid) continue;
+            wsum += fu->sensor[i].weight;
+            total += fu->sensor[i].weight * fu->sensor[i].value;
+        }
+        return total / wsum;
+    }
+
+    if (strcmp(sensor_fusion, "kalman") == 0) {
+        // 随机游走模型：预测时方差增加 q，每个传感器依次作为一次测量更新
+        if (!fu->primed) {
+            float total = 0.0;
+            for (int i = 0; i < fu->count; i++) {
+                if (fu->sensor[i].valid) total += fu->sensor[i].value;
+            }
+            fu->x = total / valid;
+            fu->p = fusion_r;
+            fu->primed = 1;
+        }
+        fu->p += fusion_q;
+        for (int i = 0; i < fu->count; i++) {
+            FusionSensor *s = &fu->sensor[i];
+            if (!s->valid) continue;
+            float r = fusion_r / s->weight;
+            float k = fu->p / (fu->p + r);
+            fu->x += k * (s->value - fu->x);
+            fu->p *= 1.0 - k;
+        }
+        return fu->x;
+    }
+
+    // 默认取最大值
+    float hottest = -1000.0;
+    for (int i = 0; i < fu->count; i++) {
+        if (fu->sensor[i].valid && fu->sensor[i].value > hottest) hottest = fu->sensor[i].value;
+    }
+    return hottest;
+}
+
+/**
+ * 写入各传感器读数和融合结果
+ */
+void sensor_fusion_write_status(const SensorFusion *fu, float temperature) {
+    FILE *fp = fopen(SENSOR_FILE, "w");
+    if (fp == NULL) return;
+    fprintf(fp, "fusion=%s\ntemperature=%.2f\n", fu->count > 1 ? sensor_fusion : "single", temperature);
+    if (fu->primed) {
+        fprintf(fp, "variance=%.4f\n", fu->p);
+    }
+    for (int i = 0; i < fu->count; i++) {
+        const FusionSensor *s = &fu->sensor[i];
+        fprintf(fp, "sensor%d=%s %.2f %d\n", i, s->path, s->value, s->valid);
+    }
+    fclose(fp);
+}
+
+/**
+ * 设置风扇转速
+ * @param fan_speed_set 风扇速度值（0-255）
+ * @param fan_pwm_file 风扇PWM控制文件路径
+ * @return 成功写入的字节数，失败返回0
+ */
+static unsigned long pwm_writes = 0;       // 实际写入次数
+static unsigned long pwm_elided = 0;       // 控制器给定值改变但输出不变、因而没有写入的次数
+static unsigned long pwm_shaped = 0;       // 被整形（死区、保持时间、变化率）改变了的给定值变化次数
+
+int set_fanspeed(int fan_speed_set, char* fan_pwm_file) {
+    // 与上次写入的值相同时不写（定期重写一次）
+    static int last_value = -1;
+    static time_t last_time = 0;
+    time_t now = time(NULL);
+    if (fan_speed_set == last_value && difftime(now, last_time) < PWM_REFRESH_TIME) {
+        return 0;
+    }
+
+    // PWM文件经批量写入接口保持打开，每次从偏移0处写入；路径改变时重新打开，写入失败时下次单独重新打开。
+    // 只有一个风扇时 io_uring 没有收益，直接 pwrite
+    static SysfsBatch pwm_io;
+    static char path[MAX_LENGTH];
+    if (!pwm_io.opened || strcmp(path, fan_pwm_file) != 0) {
+        const char* paths[1] = { path };
+        snprintf(path, sizeof(path), "%s", fan_pwm_file);
+        sysfs_batch_open(&pwm_io, paths, 1, O_WRONLY, 0);
+    }
+
+    int ret = sysfs_batch_write(&pwm_io, &fan_speed_set) == 1;
+    last_value = ret > 0 ? fan_speed_set : -1;
+    last_time = now;
+    pwm_writes++;
+    return ret;
+}
+
+/**
+ * 读取当前风扇速度
+ * @param fan_speed_file 风扇速度读取文件路径
+ * @return 风扇速度（RPM），读取失败返回-1
+ */
+int get_fanspeed(char* fan_speed_file) {
+    char buf[8] = { 0 };
+    if (read_file(fan_speed_file, buf, 0) == 0) {
+        return atoi(buf);
+    }
+    return -1;
+}
+
+/**
+ * 读取风扇速度，启用异步读取时只读取缓存值，不访问设备
+ * @return 风扇速度（RPM），读取失败或缓存过期返回-1
+ */
+int fan_speed_read(void) {
+    if (fan_thread) {
+        float rpm = sensor_slot_load(&sensor_slots[FAN_SLOT]);
+        return rpm == -1.0 ? -1 : (int)lroundf(rpm);
+    }
+    return get_fanspeed(fan_speed_file);
+}
+
+/**
+ * 风扇PWM-转速标定曲线
+ * 由标定扫描得到，按hwmon设备名保存，只需标定一次
+ */
+typedef struct {
+    int valid;                              // 是否已加载
+    char name[64];                          // hwmon设备名
+    int start_duty;                         // 风扇从静止启动所需的最小PWM
+    int sustain_duty;                       // 风扇保持转动的最小PWM
+    int saturation_duty;                    // 转速达到饱和的PWM，更高的PWM不再提升转速
+    int max_rpm;                            // 饱和转速
+    int count;                              // 曲线点数
+    int pwm[PROFILE_MAX_POINTS];            // 曲线点PWM（递增）
+    int rpm[PROFILE_MAX_POINTS];            // 曲线点转速（单调不减）
+} FanProfile;
+
+FanProfile fan_profile;
+
+/**
+ * 获取风扇所在hwmon设备名（读取PWM文件同目录下的name文件）
+ * @return 成功返回0，失败返回-1
+ */
+static int get_hwmon_name(const char* pwm_file, char* name, size_t size) {
+    char path[MAX_LENGTH + 8];
+    FILE* fp;
+
+    snprintf(path, sizeof(path), "%s", pwm_file);
+    char* slash = strrchr(path, '/');
+    if (slash == NULL) return -1;
+    strcpy(slash + 1, "name");
+
+    fp = fopen(path, "r");
+    if (fp == NULL) return -1;
+    if (fgets(name, size, fp) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    name[strcspn(name, "\n")] = 0;
+
+    // 设备名用作文件名，替换不安全字符
+    for (char* p = name; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '-' && *p != '_') *p = '_';
+    }
+    return name[0] ? 0 : -1;
+}
+
+static void profile_path(const FanProfile* prof, char* path, size_t size) {
+    snprintf(path, size, "%s/%s.profile", PROFILE_DIR, prof->name);
+}
+
+/**
+ * 加载标定曲线
+ * @return 成功返回0，失败返回-1
+ */
+static int profile_load(FanProfile* prof) {
+    char path[MAX_LENGTH];
+    char line[128];
+    FILE* fp;
+
+    profile_path(prof, path, sizeof(path));
+    fp = fopen(path, "r");
+    if (fp == NULL) return -1;
+
+    prof->count = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        int a, b;
+        if (sscanf(line, "start_duty=%d", &a) == 1) prof->start_duty = a;
+        else if (sscanf(line, "sustain_duty=%d", &a) == 1) prof->sustain_duty = a;
+        else if (sscanf(line, "saturation_duty=%d", &a) == 1) prof->saturation_duty = a;
+        else if (sscanf(line, "max_rpm=%d", &a) == 1) prof->max_rpm = a;
+        else if (sscanf(line, "point=%d %d", &a, &b) == 2 && prof->count < PROFILE_MAX_POINTS) {
+            prof->pwm[prof->count] = a;
+            prof->rpm[prof->count] = b;
+            prof->count++;
+        }
+    }
+    fclose(fp);
+
+    prof->valid = prof->count >= 2 && prof->max_rpm > 0 && prof->sustain_duty > 0;
+    return prof->valid ? 0 : -1;
+}
+
+/**
+ * 保存标定曲线
+ * @return 成功返回0，失败返回-1
+ */
+static int profile_save(const FanProfile* prof) {
+    char path[MAX_LENGTH];
+    FILE* fp;
+
+    mkdir(PROFILE_DIR, 0755);
+    profile_path(prof, path, sizeof(path));
+    fp = fopen(path, "w");
+    if (fp == NULL) return -1;
+
+    fprintf(fp, "# fancontrol fan profile for hwmon '%s'\n", prof->name);
+    fprintf(fp, "start_duty=%d\n", prof->start_duty);
+    fprintf(fp, "sustain_duty=%d\n", prof->sustain_duty);
+    fprintf(fp, "saturation_duty=%d\n", prof->saturation_duty);
+    fprintf(fp, "max_rpm=%d\n", prof->max_rpm);
+    for (int i = 0; i < prof->count; i++) {
+        fprintf(fp, "point=%d %d\n", prof->pwm[i], prof->rpm[i]);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * 标定扫描：PWM从0升到255再降回0，记录转速
+ * 上升过程得到启动PWM，下降过程得到维持PWM、饱和点和转速曲线。
+ * 扫描在控制循环中逐周期推进（每个点等待 calibrate_settle 秒），期间失效保护和超温保护照常生效
+ */
+enum {
+    CALIBRATE_IDLE,         // 未在标定
+    CALIBRATE_STOP,         // 等待风扇停转
+    CALIBRATE_UP,           // 上升扫描
+    CALIBRATE_DOWN,         // 下降扫描
+};
+
+typedef struct {
+    int phase;
+    int pwm;                                // 当前扫描点的PWM
+    double due;                             // 读取当前点转速的时间（单调时钟）
+    double stop_until;                      // 等待停转的最长时间
+    int n;                                  // 下降扫描已记录的点数
+    int pwm_pts[PROFILE_MAX_POINTS];        // 下降扫描记录的PWM（递减）
+    int rpm_pts[PROFILE_MAX_POINTS];
+    FanProfile prof;                        // 正在标定的曲线
+} Calibration;
+
+Calibration calibration;
+
+static void calibrate_failed_path(const char* name, char* path, size_t size) {
+    snprintf(path, size, "%s/%s.failed", PROFILE_DIR, name);
+}
+
+// 切换到下一个扫描点
+static void calibrate_set_point(Calibration* cal, int pwm, double now) {
+    cal->pwm = pwm;
+    cal->due = now + (calibrate_settle > 0 ? calibrate_settle : 1);
+}
+
+/**
+ * 开始标定扫描
+ * @return 成功返回0，无法确定hwmon设备名返回-1
+ */
+static int calibrate_start(Calibration* cal, double now) {
+    memset(cal, 0, sizeof(*cal));
+    if (get_hwmon_name(fan_pwm_file, cal->prof.name, sizeof(cal->prof.name)) != 0) {
+        fprintf(stderr, "Cannot determine hwmon name for '%s', calibration disabled\n", fan_pwm_file);
+        return -1;
+    }
+    fprintf(stderr, "Calibrating fan '%s', this takes a few minutes\n", cal->prof.name);
+    cal->phase = CALIBRATE_STOP;
+    cal->stop_until = now + 10;
+    calibrate_set_point(cal, 0, now);
+    return 0;
+}
+
+/**
+ * 结束标定：成功时保存并启用曲线；失败时保留原有曲线并记录失败，之后启动时不再自动重试
+ */
+static void calibrate_finish(Calibration* cal, int ok) {
+    char path[MAX_LENGTH];
+    calibrate_failed_path(cal->prof.name, path, sizeof(path));
+    if (ok) {
+        fan_profile = cal->prof;
+        if (profile_save(&fan_profile) != 0) {
+            fprintf(stderr, "Warning: cannot save fan profile to %s\n", PROFILE_DIR);
+        }
+        unlink(path);
+    } else {
+        mkdir(PROFILE_DIR, 0755);
+        FILE* fp = fopen(path, "w");
+        if (fp) {
+            fprintf(fp, "# calibration failed, run 'fancontrol -C' or 'fancontrol-ctl calibrate' to retry\n");
+            fclose(fp);
+        }
+    }
+    cal->phase = CALIBRATE_IDLE;
+}
+
+// 由下降扫描的记录生成曲线
+static int calibrate_build_profile(Calibration* cal) {
+    FanProfile* prof = &cal->prof;
+    int n = cal->n;
+    if (n < 2) {
+        fprintf(stderr, "Calibration failed: not enough points on the fan curve\n");
+        return -1;
+    }
+
+    // 反转为PWM递增顺序，并保证转速单调不减
+    prof->count = n;
+    for (int i = 0; i < n; i++) {
+        prof->pwm[i] = cal->pwm_pts[n - 1 - i];
+        prof->rpm[i] = cal->rpm_pts[n - 1 - i];
+        if (i > 0 && prof->rpm[i] < prof->rpm[i - 1]) prof->rpm[i] = prof->rpm[i - 1];
+    }
+
+    // 饱和点：达到最大转速97%的最小PWM
+    prof->max_rpm = prof->rpm[n - 1];
+    prof->saturation_duty = prof->pwm[n - 1];
+    for (int i = 0; i < n; i++) {
+        if (prof->rpm[i] >= prof->max_rpm * 97 / 100) {
+            prof->saturation_duty = prof->pwm[i];
+            break;
+        }
+    }
+    prof->valid = 1;
+
+    fprintf(stderr, "Calibration done: start %d, sustain %d, saturation %d (%d RPM)\n",
+        prof->start_duty, prof->sustain_duty, prof->saturation_duty, prof->max_rpm);
+    return 0;
+}
+
+/**
+ * 推进标定扫描，每个控制周期调用一次
+ * @param cal 标定状态
+ * @param temperature 当前温度
+ * @param now 单调时钟（秒）
+ * @return 本周期应写入的PWM；标定结束（成功或失败）时返回-1
+ */
+static int calibrate_step(Calibration* cal, float temperature, double now) {
+    float temp_limit = target_temp + 15 < MAX_TEMP ? target_temp + 15 : MAX_TEMP;
+    if (temperature >= temp_limit) {
+        fprintf(stderr, "Calibration aborted: temperature above %.0f°C\n", temp_limit);
+        calibrate_finish(cal, 0);
+        return -1;
+    }
+    if (now < cal->due) return cal->pwm;
+
+    int rpm = fan_speed_read();
+    if (rpm < 0) {
+        fprintf(stderr, "Calibration failed: cannot read '%s'\n", fan_speed_file);
+        calibrate_finish(cal, 0);
+        return -1;
+    }
+
+    switch (cal->phase) {
+        case CALIBRATE_STOP:
+            // 先停转，确保从静止开始
+            if (rpm > 0 && now < cal->stop_until) {
+                cal->due = now + 1;
+                return cal->pwm;
+            }
+            cal->phase = CALIBRATE_UP;
+            calibrate_set_point(cal, CALIBRATE_STEP, now);
+            return cal->pwm;
+
+        case CALIBRATE_UP:
+            // 第一个有转速的PWM即启动PWM
+            if (rpm > 0) {
+                cal->prof.start_duty = cal->pwm;
+                cal->phase = CALIBRATE_DOWN;
+                calibrate_set_point(cal, 255, now);
+            } else if (cal->pwm >= 255) {
+                fprintf(stderr, "Calibration failed: fan does not spin at full PWM\n");
+                calibrate_finish(cal, 0);
+                return -1;
+            } else {
+                calibrate_set_point(cal, cal->pwm + CALIBRATE_STEP > 255 ? 255 : cal->pwm + CALIBRATE_STEP, now);
+            }
+            return cal->pwm;
+
+        case CALIBRATE_DOWN:
+            // 从满速逐步降低，记录曲线直到停转
+            if (rpm > 0) {
+                cal->pwm_pts[cal->n] = cal->pwm;
+                cal->rpm_pts[cal->n] = rpm;
+                cal->prof.sustain_duty = cal->pwm;
+                cal->n++;
+                if (cal->pwm > CALIBRATE_STEP && cal->n < PROFILE_MAX_POINTS) {
+                    calibrate_set_point(cal, cal->pwm - CALIBRATE_STEP, now);
+                    return cal->pwm;
+                }
+            }
+            calibrate_finish(cal, calibrate_build_profile(cal) == 0);
+            return -1;
+
+        default:
+            return -1;
+    }
+}
+
+/**
+ * 在标定曲线上查找达到指定转速所需的PWM（线性插值）
+ * @return PWM值
+ */
+int profile_pwm_for_rpm(const FanProfile* prof, int rpm) {
+    if (rpm <= prof->rpm[0]) return prof->pwm[0];
+    for (int i = 1; i < prof->count; i++) {
+        if (rpm <= prof->rpm[i]) {
+            int dr = prof->rpm[i] - prof->rpm[i - 1];
+            if (dr <= 0) return prof->pwm[i];
+            return prof->pwm[i - 1] + (prof->pwm[i] - prof->pwm[i - 1]) * (rpm - prof->rpm[i - 1]) / dr;
+        }
+    }
+    return prof->pwm[prof->count - 1];
+}
+
+/**
+ * 在标定曲线上查找指定PWM对应的转速（线性插值）
+ * @return 转速（RPM）
+ */
+int profile_rpm_for_pwm(const FanProfile* prof, int pwm) {
+    if (pwm <= prof->pwm[0]) return prof->rpm[0];
+    for (int i = 1; i < prof->count; i++) {
+        if (pwm <= prof->pwm[i]) {
+            int dp = prof->pwm[i] - prof->pwm[i - 1];
+            return prof->rpm[i - 1] + (prof->rpm[i] - prof->rpm[i - 1]) * (pwm - prof->pwm[i - 1]) / dp;
+        }
+    }
+    return prof->rpm[prof->count - 1];
+}
+
+/**
+ * 加载标定曲线，不存在时（或强制标定时）开始标定，由控制循环完成后保存
+ * 上次标定失败时不自动重试，需要 -C 或 fancontrol-ctl calibrate
+ */
+static void setup_fan_profile(void) {
+    if (get_hwmon_name(fan_pwm_file, fan_profile.name, sizeof(fan_profile.name)) != 0) {
+        fprintf(stderr, "Cannot determine hwmon name for '%s', calibration disabled\n", fan_pwm_file);
+        return;
+    }
+    if (!calibrate_force && profile_load(&fan_profile) == 0) {
+        return;
+    }
+    char path[MAX_LENGTH];
+    calibrate_failed_path(fan_profile.name, path, sizeof(path));
+    if (!calibrate_force && access(path, F_OK) == 0) {
+        fprintf(stderr, "Previous calibration of '%s' failed, run 'fancontrol -C' or 'fancontrol-ctl calibrate' to retry\n", fan_profile.name);
+        return;
+    }
+    calibrate_start(&calibration, monotonic_seconds());
+}
+
+/**
+ * 计算风扇转速
+ */
+// PID 控制器参数
+typedef struct {
+    float Kp;
+    float Ki;
+    float Kd;
+    float Kb;               // 反算抗饱和增益（每秒）
+    float out_min;          // 输出下限
+    float out_max;          // 输出上限
+    float integral;         // 积分项（已乘Ki，与输出同单位）
+    float prev_measurement; // 上一次测量值（用于测量值微分）
+    float prev_error;       // 上一次误差（用于参数切换时的无扰处理）
+    int primed;             // 是否已有上一次测量值
+    float feedforward;      // 前馈输出（%），参与限幅和抗饱和
+    float core;             // 上一次的反馈部分输出（P+I+D，未限幅）
+    float p_term;           // 上一次的比例项
+    float d_term;           // 上一次的微分项
+} PIDController;
+
+// 初始化 PID 控制器
+void PID_Init(PIDController *pid, float Kp, float Ki, float Kd) {
+    pid->Kp = Kp;
+    pid->Ki = Ki;
+    pid->Kd = Kd;
+    pid->Kb = Kb;
+    pid->out_min = 0.0;
+    pid->out_max = 100.0;
+    pid->integral = 0;
+    pid->prev_measurement = 0;
+    pid->prev_error = 0;
+    pid->primed = 0;
+    pid->feedforward = 0;
+    pid->core = 0;
+}
+
+// 修改 PID 参数（无扰切换）
+// 积分项已乘Ki，修改Ki不影响输出；修改Kp时补偿积分项，使输出保持连续
+void PID_SetTunings(PIDController *pid, float Kp, float Ki, float Kd) {
+    if (pid->primed) {
+        pid->integral += (pid->Kp - Kp) * pid->prev_error;
+    }
+    pid->Kp = Kp;
+    pid->Ki = Ki;
+    pid->Kd = Kd;
+    pid->Kb = Kb;
+}
+
+// PID 计算，返回限幅后的输出
+float PID_Calculate(PIDController *pid, float setpoint, float actual_value, float dt) {
+    // 误差计算：实际温度 - 目标温度
+    // 当实际温度高于目标温度时，误差为正，需要增加风扇速度
+    float error = actual_value - setpoint;
+
+    // 微分作用于（已滤波的）测量值而不是误差，目标温度变化时输出不会突跳
+    float derivative = 0.0;
+    if (pid->primed) {
+        derivative = (actual_value - pid->prev_measurement) / dt;
+    }
+    pid->prev_measurement = actual_value;
+    pid->prev_error = error;
+    pid->primed = 1;
+
+    float proportional = pid->Kp * error;
+    float output = proportional + pid->integral + pid->Ki * error * dt + pid->Kd * derivative + pid->feedforward;
+
+    // 输出限幅
+    float output_sat = output;
+    if (output_sat > pid->out_max) output_sat = pid->out_max;
+    if (output_sat < pid->out_min) output_sat = pid->out_min;
+
+    // 反算抗饱和：积分项按输出饱和量回退，积分只在输出未饱和的范围内累积
+    // 每次回退量不超过饱和量本身（Kb*dt 限制在[0,1]），否则计算间隔较长时积分会反复变号并发散
+    float back = pid->Kb * dt;
+    if (back > 1.0) back = 1.0;
+    if (back < 0.0) back = 0.0;
+    pid->integral += pid->Ki * error * dt + back * (output_sat - output);
+    pid->core = proportional + pid->integral + pid->Kd * derivative;
+    pid->p_term = proportional;
+    pid->d_term = pid->Kd * derivative;
+
+    return output_sat;
+}
+
+// 只更新前馈，不做PID计算，返回新的限幅后输出
+// 前馈在两次PID计算之间变化较大时使用，使风扇提前响应负载
+float PID_UpdateFeedforward(PIDController *pid, float feedforward) {
+    pid->feedforward = feedforward;
+    float output = pid->core + feedforward;
+    if (output > pid->out_max) output = pid->out_max;
+    if (output < pid->out_min) output = pid->out_min;
+    return output;
+}
+
+// 当前前馈输出（%）
+static float feedforward_total = 0.0;
+
+/**
+ * 分段线性风扇曲线控制器
+ * 加载配置时把曲线编译为按传感器分辨率索引的查找表，
+ * 每次计算只需一次乘法取索引，不做浮点插值
+ */
+typedef struct {
+    uint8_t lut[CURVE_LUT_SIZE];    // 查找表：索引为温度/步长，值为PWM
+    int size;                       // 查找表有效长度
+    float scale;                    // 1/步长
+    int rise;                       // 升温滞环（索引步数）
+    int fall;                       // 降温滞环（索引步数）
+    int applied;                    // 当前采用的索引，-1表示尚未取值
+} CurveController;
+
+// 编译风扇曲线
+// @return 成功返回0，没有配置曲线点返回-1
+int Curve_Init(CurveController *curve, int temp_div) {
+    if (curve_points == 0) return -1;
+
+    // 步长取传感器分辨率，但不小于 CURVE_MIN_STEP
+    float step = temp_div > 0 ? 1.0 / temp_div : 1.0;
+    if (step < CURVE_MIN_STEP) step = CURVE_MIN_STEP;
+    curve->scale = 1.0 / step;
+    curve->size = (int)(MAX_TEMP * curve->scale) + 1;
+    if (curve->size > CURVE_LUT_SIZE) curve->size = CURVE_LUT_SIZE;
+    curve->rise = (int)(curve_hyst_rise * curve->scale + 0.5);
+    curve->fall = (int)(curve_hyst_fall * curve->scale + 0.5);
+    curve->applied = -1;
+
+    int seg = 0;
+    for (int i = 0; i < curve->size; i++) {
+        float t = i * step;
+        int pwm;
+        while (seg < curve_points - 1 && t > curve_temp[seg + 1]) seg++;
+        if (t <= curve_temp[0]) {
+            pwm = curve_pwm[0];
+        } else if (seg >= curve_points - 1) {
+            pwm = curve_pwm[curve_points - 1];
+        } else {
+            float span = curve_temp[seg + 1] - curve_temp[seg];
+            float frac = span > 0 ? (t - curve_temp[seg]) / span : 1.0;
+            pwm = (int)(curve_pwm[seg] + frac * (curve_pwm[seg + 1] - curve_pwm[seg]) + 0.5);
+        }
+        if (pwm < 0) pwm = 0;
+        if (pwm > 255) pwm = 255;
+        curve->lut[i] = (uint8_t)pwm;
+    }
+    return 0;
+}
+
+// 风扇曲线计算，返回PWM
+int Curve_Calculate(CurveController *curve, float current_temp) {
+    int idx = (int)(current_temp * curve->scale + 0.5);
+    if (idx < 0) idx = 0;
+    if (idx >= curve->size) idx = curve->size - 1;
+
+    // 升温和降温分别带滞环：只有越过滞环时才采用新的温度点
+    if (curve->applied < 0 || idx > curve->applied + curve->rise || idx < curve->applied - curve->fall) {
+        curve->applied = idx;
+    }
+    return curve->lut[curve->applied];
+}
+
+/**
+ * 开关（两点式）控制器
+ * 温度高于 目标温度+bang_hyst 时全速，低于 目标温度-bang_hyst 时停止，其间保持原状态
+ */
+typedef struct {
+    int on;     // 当前是否开启
+} BangBangController;
+
+/**
+ * 控制器接口
+ * 每种控制策略实现一组操作，主循环只通过接口调用，由 controller 选项从注册表中选择
+ */
+typedef union {
+    PIDController pid;
+    CurveController curve;
+    BangBangController bang;
+} ControllerState;
+
+typedef struct {
+    const char* name;
+    int direct_pwm;     // step 直接输出PWM (0-255)；否则输出百分比 (0-100)，经 output_to_pwm 换算
+    int (*init)(ControllerState* st);                                           // 按当前配置初始化，失败返回-1
+    float (*step)(ControllerState* st, float temp, float setpoint, float dt);  // 计算一次输出
+    void (*reset)(ControllerState* st);                                         // 清除运行状态
+    size_t (*snapshot)(const ControllerState* st, void* buf, size_t size);     // 导出运行状态，返回字节数
+    void (*restore)(ControllerState* st, const void* buf, size_t len);         // 导入运行状态
+} ControllerOps;
+
+typedef struct {
+    const ControllerOps* ops;
+    ControllerState st;
+} Controller;
+
+// PID：运行状态快照
+typedef struct {
+    float Kp;
+    float integral;
+    float prev_measurement;
+    float prev_error;
+    int primed;
+    float feedforward;
+    float core;
+} PIDSnapshot;
+
+static int pid_ctrl_init(ControllerState* st) {
+    PID_Init(&st->pid, Kp, Ki, Kd);
+    return 0;
+}
+
+static float pid_ctrl_step(ControllerState* st, float temp, float setpoint, float dt) {
+    st->pid.feedforward = feedforward_total;
+    return PID_Calculate(&st->pid, setpoint, temp, dt);
+}
+
+static void pid_ctrl_reset(ControllerState* st) {
+    PID_Init(&st->pid, st->pid.Kp, st->pid.Ki, st->pid.Kd);
+}
+
+static size_t pid_ctrl_snapshot(const ControllerState* st, void* buf, size_t size) {
+    const PIDController* pid = &st->pid;
+    PIDSnapshot snap = { pid->Kp, pid->integral, pid->prev_measurement, pid->prev_error, pid->primed, pid->feedforward, pid->core };
+    if (size < sizeof(snap)) return 0;
+    memcpy(buf, &snap, sizeof(snap));
+    return sizeof(snap);
+}
+
+// 恢复运行状态，参数已变化时按 PID_SetTunings 的方式补偿积分项（无扰切换）
+static void pid_ctrl_restore(ControllerState* st, const void* buf, size_t len) {
+    PIDSnapshot snap;
+    if (len != sizeof(snap)) return;
+    memcpy(&snap, buf, sizeof(snap));
+    PIDController* pid = &st->pid;
+    float kp = pid->Kp, ki = pid->Ki, kd = pid->Kd;
+    pid->Kp = snap.Kp;
+    pid->integral = snap.integral;
+    pid->prev_measurement = snap.prev_measurement;
+    pid->prev_error = snap.prev_error;
+    pid->primed = snap.primed;
+    pid->feedforward = snap.feedforward;
+    pid->core = snap.core;
+    PID_SetTunings(pid, kp, ki, kd);
+}
+
+// 曲线：快照只保存当前采用的温度点，查找表随配置重新编译
+static int curve_ctrl_init(ControllerState* st) {
+    if (Curve_Init(&st->curve, temp_div) != 0) {
+        fprintf(stderr, "Curve controller needs curve_point entries\n");
+        return -1;
+    }
+    return 0;
+}
+
+static float curve_ctrl_step(ControllerState* st, float temp, float setpoint, float dt) {
+    (void)setpoint;
+    (void)dt;
+    return Curve_Calculate(&st->curve, temp);
+}
+
+static void curve_ctrl_reset(ControllerState* st) {
+    st->curve.applied = -1;
+}
+
+static size_t curve_ctrl_snapshot(const ControllerState* st, void* buf, size_t size) {
+    float temp = st->curve.applied < 0 ? -1.0 : st->curve.applied / st->curve.scale;
+    if (size < sizeof(temp)) return 0;
+    memcpy(buf, &temp, sizeof(temp));
+    return sizeof(temp);
+}
+
+static void curve_ctrl_restore(ControllerState* st, const void* buf, size_t len) {
+    float temp;
+    if (len != sizeof(temp)) return;
+    memcpy(&temp, buf, sizeof(temp));
+    if (temp < 0) {
+        st->curve.applied = -1;
+        return;
+    }
+    int idx = (int)(temp * st->curve.scale + 0.5);
+    st->curve.applied = idx < st->curve.size ? idx : st->curve.size - 1;
+}
+
+// 开关控制
+static int bang_ctrl_init(ControllerState* st) {
+    st->bang.on = 0;
+    return 0;
+}
+
+static float bang_ctrl_step(ControllerState* st, float temp, float setpoint, float dt) {
+    (void)dt;
+    if (temp >= setpoint + bang_hyst) {
+        st->bang.on = 1;
+    } else if (temp <= setpoint - bang_hyst) {
+        st->bang.on = 0;
+    }
+    return st->bang.on ? 100.0 : 0.0;
+}
+
+static void bang_ctrl_reset(ControllerState* st) {
+    st->bang.on = 0;
+}
+
+static size_t bang_ctrl_snapshot(const ControllerState* st, void* buf, size_t size) {
+    if (size < sizeof(st->bang)) return 0;
+    memcpy(buf, &st->bang, sizeof(st->bang));
+    return sizeof(st->bang);
+}
+
+static void bang_ctrl_restore(ControllerState* st, const void* buf, size_t len) {
+    if (len == sizeof(st->bang)) memcpy(&st->bang, buf, len);
+}
+
+static const ControllerOps pid_controller_ops = {
+    "pid", 0, pid_ctrl_init, pid_ctrl_step, pid_ctrl_reset, pid_ctrl_snapshot, pid_ctrl_restore
+};
+static const ControllerOps curve_controller_ops = {
+    "curve", 1, curve_ctrl_init, curve_ctrl_step, curve_ctrl_reset, curve_ctrl_snapshot, curve_ctrl_restore
+};
+static const ControllerOps bang_controller_ops = {
+    "bang", 0, bang_ctrl_init, bang_ctrl_step, bang_ctrl_reset, bang_ctrl_snapshot, bang_ctrl_restore
+};
+
+// 控制器注册表，新的控制策略在此添加
+static const ControllerOps* const controller_registry[] = {
+    &pid_controller_ops,
+    &curve_controller_ops,
+    &bang_controller_ops,
+};
+
+// 按名称查找控制器，找不到返回NULL
+const ControllerOps* controller_find(const char* name) {
+    for (size_t i = 0; i < sizeof(controller_registry) / sizeof(controller_registry[0]); i++) {
+        if (strcmp(controller_registry[i]->name, name) == 0) return controller_registry[i];
+    }
+    return NULL;
+}
+
+/**
+ * 选择并初始化控制器
+ * 与当前控制器相同时保留运行状态（重新加载配置时无扰切换）；
+ * 找不到或初始化失败时退回 PID
+ * @param c 控制器实例
+ * @param name 控制器名称
+ */
+void controller_select(Controller* c, const char* name) {
+    const ControllerOps* ops = controller_find(name);
+    if (!ops) {
+        fprintf(stderr, "Unknown controller '%s', falling back to PID\n", name);
+        ops = &pid_controller_ops;
+    }
+
+    unsigned char snap[CONTROLLER_SNAPSHOT_MAX];
+    size_t len = c->ops ? c->ops->snapshot(&c->st, snap, sizeof(snap)) : 0;
+    const ControllerOps* prev = c->ops;
+
+    if (ops->init(&c->st) != 0) {
+        fprintf(stderr, "Controller '%s' unavailable, falling back to PID\n", ops->name);
+        ops = &pid_controller_ops;
+        ops->init(&c->st);
+    }
+    if (prev == ops && len > 0) {
+        ops->restore(&c->st, snap, len);
+    }
+    c->ops = ops;
+}
+
+// 当前控制器为 PID 时返回其状态，否则返回NULL（前馈和自适应只作用于 PID）
+PIDController* controller_pid(Controller* c) {
+    return c->ops == &pid_controller_ops ? &c->st.pid : NULL;
+}
+
+// 温度控制器实例
+static Controller temp_ctrl;
+
+// 将控制器输出百分比 (0-100) 换算为PWM
+int output_to_pwm(float pid_output, int max_speed, int min_speed) {
+    // 有标定曲线时按转速线性化输出，跳过无效的PWM区间
+    if (fan_profile.valid) {
+        static int stopped = 1;
+        if (pid_output <= 0.0) {
+            stopped = 1;
+            return 0;
+        }
+        int top = max_speed < fan_profile.saturation_duty ? max_speed : fan_profile.saturation_duty;
+        int rpm_lo = profile_rpm_for_pwm(&fan_profile, fan_profile.sustain_duty);
+        int rpm_hi = profile_rpm_for_pwm(&fan_profile, top);
+        int pwm = profile_pwm_for_rpm(&fan_profile, rpm_lo + (int)(pid_output / 100.0 * (rpm_hi - rpm_lo) + 0.5));
+        // 从静止启动时至少使用启动PWM
+        if (stopped && pwm < fan_profile.start_duty) pwm = fan_profile.start_duty;
+        stopped = 0;
+        return pwm > max_speed ? max_speed : pwm;
+    }
+
+    // 计算百分比 (0-1.0)
+    float percentage = pid_output / 100.0;
+
+    // 根据百分比计算风扇速度
+    // 当percentage为0时，风扇速度为0（停止）
+    // 当percentage大于0时，风扇速度从min_speed开始
+    float fan_speed_float;
+    if (percentage <= 0.0) {
+        fan_speed_float = 0.0; // PID输出为0时风扇停止
+    } else {
+        fan_speed_float = min_speed + (percentage * (max_speed - min_speed));
+    }
+    
+    int fan_speed_set = (int)(fan_speed_float + 0.5); // 四舍五入
+
+    // 限制风扇速度在有效范围内
+    if (fan_speed_set > max_speed) {
+        fan_speed_set = max_speed;
+    } else if (fan_speed_set < 0) {
+        fan_speed_set = 0; // 确保不会出现负值
+    }
+    
+    return fan_speed_set;
+}
+
+// 计算风扇转速，dt 为距上次计算的时间（秒）
+int calculate_speed_set(Controller* c, float current_temp, int target_temp, int max_speed, int min_speed, float dt) {
+    float output = c->ops->step(&c->st, current_temp, (float)target_temp, dt);
+    if (c->ops->direct_pwm) {
+        int pwm = (int)(output + 0.5);
+        return pwm > max_speed ? max_speed : pwm;
+    }
+    return output_to_pwm(output, max_speed, min_speed);
+}
+
+/**
+ * 串级控制：计算内环目标转速
+ * 外环控制器输出的百分比按 max_rpm 换算为目标转速（直接输出PWM的控制器不使用串级）
+ * @param dt 距上次计算的时间（秒）
+ * @return 目标转速（RPM），0表示风扇停止
+ */
+int calculate_rpm_set(Controller* c, float current_temp, int target_temp, float dt) {
+    float output = c->ops->step(&c->st, current_temp, (float)target_temp, dt);
+    return (int)(output / 100.0 * max_rpm + 0.5);
+}
+
+/**
+ * 串级控制内环（转速 PI 控制器）状态
+ */
+typedef struct {
+    float integral;     // 积分项（PWM计数）
+} RPMLoop;
+
+/**
+ * 内环计算：根据转速反馈调节PWM使风扇达到目标转速
+ * 以目标转速的线性估计作为前馈，PI 仅补偿风扇的非线性和老化偏差
+ * @param loop 内环状态
+ * @param target_rpm 目标转速
+ * @param rpm 当前转速，读取失败时为-1
+ * @param dt 内环周期（秒）
+ * @return PWM值
+ */
+int rpm_loop_step(RPMLoop *loop, int target_rpm, int rpm, float dt) {
+    if (target_rpm <= 0) {
+        loop->integral = 0;
+        return 0;
+    }
+
+    // 前馈：有标定曲线时查表，否则假设转速与PWM在 start_speed..max_speed 之间线性
+    float ff;
+    if (fan_profile.valid) {
+        ff = profile_pwm_for_rpm(&fan_profile, target_rpm);
+    } else {
+        ff = start_speed + (float)target_rpm / max_rpm * (max_speed - start_speed);
+    }
+    if (rpm < 0) {
+        return (int)(ff + 0.5);
+    }
+
+    float error = (float)(target_rpm - rpm);
+    float output = ff + rpm_Kp * error + loop->integral;
+
+    // 输出饱和时停止向饱和方向积分，防止积分饱和
+    if (!(output >= max_speed && error > 0) && !(output <= start_speed && error < 0)) {
+        loop->integral += rpm_Ki * error * dt;
+        output = ff + rpm_Kp * error + loop->integral;
+    }
+
+    if (output > max_speed) output = max_speed;
+    if (output < start_speed) output = start_speed;
+    return (int)(output + 0.5);
+}
+
+/**
+ * 风扇停转检测状态
+ */
+typedef struct {
+    time_t zero_since;  // 转速开始为0的时间，0表示未计时
+    time_t spin_since;  // 在控制器给定速度下持续运转的开始时间
+    time_t kick_until;  // 启动脉冲结束时间，0表示未处于脉冲中
+    int stall_count;    // 连续停转次数
+    int alarm;          // 是否已告警
+} StallMonitor;
+
+// 风扇连续正常运转超过该时间（秒）后清零停转计数
+#define STALL_RESET_TIME 60
+
+/**
+ * 根据转速反馈更新停转检测状态
+ * @param sm 停转检测状态
+ * @param pwm_set 控制器给定的PWM值
+ * @param rpm 当前风扇转速，读取失败时为-1
+ * @param now 当前时间
+ * @return 实际应写入的PWM值（启动脉冲期间为最大速度）
+ */
+int stall_monitor_update(StallMonitor *sm, int pwm_set, int rpm, time_t now) {
+    // 启动脉冲期间保持全速，结束后回到控制器给定值并重新计时
+    if (sm->kick_until != 0) {
+        if (now < sm->kick_until) {
+            return max_speed;
+        }
+        sm->kick_until = 0;
+        sm->zero_since = 0;
+        sm->spin_since = 0;
+    }
+
+    // 没有转速反馈或风扇本应停止时不做判断
+    if (rpm < 0 || pwm_set <= 0) {
+        sm->zero_since = 0;
+        sm->spin_since = 0;
+        return pwm_set;
+    }
+
+    if (rpm > 0) {
+        sm->zero_since = 0;
+        if (sm->spin_since == 0) {
+            sm->spin_since = now;
+        } else if (sm->stall_count > 0 && difftime(now, sm->spin_since) >= STALL_RESET_TIME) {
+            if (sm->alarm) {
+                fprintf(stderr, "Fan recovered at PWM %d (%d RPM)\n", pwm_set, rpm);
+            }
+            sm->stall_count = 0;
+            sm->alarm = 0;
+        }
+        return pwm_set;
+    }
+
+    // PWM>0 但转速为0
+    sm->spin_since = 0;
+    if (sm->zero_since == 0) {
+        sm->zero_since = now;
+        return pwm_set;
+    }
+    if (difftime(now, sm->zero_since) < stall_timeout) {
+        return pwm_set;
+    }
+
+    // 判定为停转，施加全速启动脉冲
+    sm->stall_count++;
+    sm->zero_since = 0;
+    sm->kick_until = now + (kick_time > 0 ? kick_time : 1);
+    fprintf(stderr, "Fan stalled at PWM %d, kick-start #%d\n", pwm_set, sm->stall_count);
+    if (stall_alarm > 0 && sm->stall_count >= stall_alarm && !sm->alarm) {
+        sm->alarm = 1;
+        fprintf(stderr, "ALARM: fan stalled %d times in a row, check fan or raise start_speed\n", sm->stall_count);
+    }
+    return max_speed;
+}
+
+/**
+ * PWM输出整形：升降速变化率限制、死区和最短保持时间
+ * 减少微小误差引起的PWM来回跳动（转速“喘振”）以及sysfs/I2C写入
+ */
+typedef struct {
+    float value;        // 当前输出（带小数，低变化率时逐步累积）
+    int output;         // 当前输出的整数值，-1表示尚未输出
+    int target;         // 上次的控制器给定值
+    double last_time;   // 上次计算时间（单调时钟，秒）
+    double change_time; // 上次输出改变的时间
+} OutputShaper;
+
+/**
+ * 对控制器给定的PWM做整形
+ * 停止（0）和最大速度不受死区限制；从静止启动时直接跳到启动速度
+ * @param sh 整形状态
+ * @param target 控制器给定的PWM值
+ * @param now 当前时间（单调时钟，秒）
+ * @return 整形后的PWM值
+ */
+int output_shaper_apply(OutputShaper *sh, int target, double now) {
+    // 只统计给定值发生变化的那一次，不按周期重复计数
+    int fresh = target != sh->target;
+    sh->target = target;
+    if (sh->output < 0) {
+        sh->value = target;
+        sh->output = target;
+        sh->last_time = now;
+        sh->change_time = now;
+        return target;
+    }
+    double dt = now - sh->last_time;
+    sh->last_time = now;
+    if (target == sh->output) {
+        sh->value = target;
+        return sh->output;
+    }
+
+    // 死区和保持时间内不改变输出
+    int held = pwm_dwell > 0 && now - sh->change_time < pwm_dwell;
+    if (!held && target != 0 && target != max_speed && abs(target - sh->output) < pwm_deadband) {
+        held = 1;
+    }
+    if (held) {
+        if (fresh) pwm_shaped++;
+        return sh->output;
+    }
+
+    // 变化率限制
+    float value = sh->value;
+    if (value <= 0 && target > 0) {
+        value = target < start_speed ? target : start_speed;
+    }
+    if (target > value) {
+        value = pwm_slew_up > 0 && value + pwm_slew_up * dt < target ? value + pwm_slew_up * dt : target;
+    } else {
+        value = pwm_slew_down > 0 && value - pwm_slew_down * dt > target ? value - pwm_slew_down * dt : target;
+        // 降到启动速度以下时直接停止，避免在无法转动的PWM区间停留
+        if (target == 0 && value < start_speed) value = 0;
+    }
+    sh->value = value;
+
+    int output = (int)(value + 0.5);
+    if (fresh && output != target) pwm_shaped++;
+    if (output != sh->output) {
+        sh->output = output;
+        sh->change_time = now;
+    }
+    return sh->output;
+}
+
+/**
+ * 停转（零转速）模式状态
+ * 风扇只在停止温度和启动温度之间按滞环启停，运行时不低于启动速度，
+ * 避免控制器输出在0附近时风扇反复启停
+ */
+typedef struct {
+    int stopped;        // 风扇是否处于停止状态
+    double since;       // 进入当前状态的时间（单调时钟，秒）
+} ZeroRPM;
+
+/**
+ * 更新停转模式状态
+ * 温度达到目标温度时不等待最短停止时间，立即启动
+ * @param z 停转模式状态
+ * @param temp 当前温度
+ * @param now 当前时间（单调时钟，秒）
+ * @return 状态改变返回1，否则返回0
+ */
+int zero_rpm_update(ZeroRPM *z, float temp, double now) {
+    double elapsed = now - z->since;
+    if (z->stopped) {
+        if (temp >= target_temp || (temp >= zero_rpm_start_temp && elapsed >= zero_rpm_min_off)) {
+            z->stopped = 0;
+            z->since = now;
+            return 1;
+        }
+    } else if (temp <= zero_rpm_stop_temp && elapsed >= zero_rpm_min_on) {
+        z->stopped = 1;
+        z->since = now;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * 计算当前生效的静音时段和下一次切换时间
+ * 只在切换时间到达时调用，不需要每秒检查
+ * @param now 当前时间
+ * @param next 输出：下一次切换时间，没有启用的条目时为0
+ * @return 生效的条目序号，没有时返回-1
+ */
+int schedule_evaluate(time_t now, time_t *next) {
+    struct tm tm;
+    localtime_r(&now, &tm);
+    int minute = tm.tm_wday * 24 * 60 + tm.tm_hour * 60 + tm.tm_min;
+    int active = -1, wait = 0;
+
+    for (int i = 0; i < schedule_count; i++) {
+        const ScheduleEntry *e = &schedule[i];
+        if (!e->enabled) continue;
+        for (int d = 0; d < 7; d++) {
+            if (!(e->days & (1 << d))) continue;
+            int begin = d * 24 * 60 + e->start;
+            int offset = (minute - begin + SCHEDULE_WEEK) % SCHEDULE_WEEK;
+            if (offset < e->length && active < 0) active = i;
+
+            // 距离该时段开始和结束的分钟数，取最近的一个
+            int to_begin = (SCHEDULE_WEEK - offset) % SCHEDULE_WEEK;
+            int to_end = (e->length - offset + SCHEDULE_WEEK) % SCHEDULE_WEEK;
+            if (to_begin == 0) to_begin = SCHEDULE_WEEK;
+            if (to_end == 0) to_end = SCHEDULE_WEEK;
+            if (wait == 0 || to_begin < wait) wait = to_begin;
+            if (to_end < wait) wait = to_end;
+        }
+    }
+
+    *next = wait > 0 ? now - tm.tm_sec + wait * 60 : 0;
+    return active;
+}
+
+/**
+ * 写入PWM输出统计
+ */
+void output_write_status(int pwm, unsigned dropped) {
+    FILE *fp = fopen(OUTPUT_FILE, "w");
+    if (fp == NULL) return;
+    fprintf(fp, "pwm=%d\nwrites=%lu\nelided=%lu\nshaped=%lu\ndropped=%u\n", pwm, pwm_writes, pwm_elided, pwm_shaped, dropped);
+    fclose(fp);
+}
+
+/**
+ * 继电反馈自整定
+ * 在目标温度附近以继电（开关）方式激励风扇，使温度形成稳定的极限环，
+ * 测量振幅a和周期Tu，得到临界增益 Ku = 4d / (π·sqrt(a²-ε²))，再按规则计算PID参数。
+ */
+#define AUTOTUNE_HYST 0.2       // 继电滞环（°C），抑制噪声引起的误切换
+#define AUTOTUNE_CYCLES 5       // 记录的振荡周期数（第一个周期丢弃）
+
+/**
+ * 根据极限环参数和整定规则计算PID参数
+ * 振荡周期和积分/微分时间均以秒为单位，得到的 Ki（%/(°C·秒)）、Kd（%/(°C/秒)）与 pid_interval 无关
+ * @param rule 整定规则：zn、tl、simc
+ * @param ku 临界增益（%/°C）
+ * @param tu 振荡周期（秒）
+ * @param a 温度振幅（°C）
+ * @param d 继电输出幅值（%）
+ */
+static void autotune_gains(const char* rule, float ku, float tu, float a, float d, float* kp, float* ki, float* kd) {
+    float ti, td;
+    if (strcmp(rule, "tl") == 0) {
+        // Tyreus-Luyben：比Ziegler-Nichols更保守，超调更小
+        *kp = ku / 2.2;
+        ti = 2.2 * tu;
+        td = tu / 6.3;
+    } else if (strcmp(rule, "simc") == 0) {
+        // SIMC：散热过程按积分加纯滞后近似，继电振荡满足 θ=Tu/4，k'=a/(d·θ)
+        // 取 τc=θ，得到 Kc=1/(2k'θ)，τI=8θ，不使用微分
+        float theta = tu / 4.0;
+        float slope = a / (d * theta);
+        *kp = 1.0 / (2.0 * slope * theta);
+        ti = 8.0 * theta;
+        td = 0.0;
+    } else {
+        // 经典 Ziegler-Nichols
+        *kp = 0.6 * ku;
+        ti = 0.5 * tu;
+        td = 0.125 * tu;
+    }
+
+    // PID按实际间隔（秒）计算积分和微分，增益直接使用秒为单位的 τI、τD
+    *ki = *kp / ti;
+    *kd = *kp * td;
+}
+
+/**
+ * 检查整定规则名
+ * @return 已知规则返回1
+ */
+static int autotune_rule_valid(const char* rule) {
+    return strcmp(rule, "zn") == 0 || strcmp(rule, "tl") == 0 || strcmp(rule, "simc") == 0;
+}
+
+/**
+ * 将整定结果写入UCI配置
+ */
+static void autotune_save(float kp, float ki, float kd) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd),
+        "uci -q set fancontrol.@settings[0].Kp='%.3f' && "
+        "uci -q set fancontrol.@settings[0].Ki='%.5f' && "
+        "uci -q set fancontrol.@settings[0].Kd='%.4f' && "
+        "uci -q set fancontrol.@settings[0].autotune='0' && "
+        "uci -q commit fancontrol", kp, ki, kd);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "Warning: cannot write tuned gains to UCI\n");
+    }
+}
+
+/**
+ * 整定失败时清除UCI中的autotune标志，避免每次启动（和procd重启）时重新运行
+ */
+static void autotune_clear(void) {
+    if (system("uci -q set fancontrol.@settings[0].autotune='0' && uci -q commit fancontrol") != 0) {
+        fprintf(stderr, "Warning: cannot clear autotune flag in UCI\n");
+    }
+}
+
+/**
+ * 继电反馈振荡测量
+ * 温度使用与控制循环相同的传感器融合结果（sensor 列表，未配置时为 thermal_file）；
+ * 温度超过 autotune_max_temp 或任一传感器达到 critical_temp 时立即中止并全速运行风扇；
+ * 连续 failsafe_reads 次没有有效读数时中止并输出 failsafe_speed；
+ * 继电输出经过停转检测，停转时按正常控制的方式发启动脉冲
+ * @param fusion 已初始化的传感器融合状态
+ * @return 成功返回0，失败返回-1
+ */
+static int autotune_relay(SensorFusion* fusion) {
+    float high = 100.0, low = autotune_low;
+    float d = (high - low) / 2.0;
+    int bad_reads = 0;
+    StallMonitor stall = { 0 };
+    float temp_limit = autotune_max_temp > 0 ? autotune_max_temp : target_temp + 10;
+    if (temp_limit > MAX_TEMP) temp_limit = MAX_TEMP;
+
+    float periods[AUTOTUNE_CYCLES], amps[AUTOTUNE_CYCLES];
+    int cycles = 0;
+    int relay_on = 0;
+    time_t start = time(NULL), last_cross = 0;
+    float cyc_max = -1000.0, cyc_min = 1000.0;
+    fprintf(stderr, "Autotune (%s): relay %.0f%%/%.0f%% around %d°C\n", autotune_rule, high, low, target_temp);
+
+    while (cycles < AUTOTUNE_CYCLES) {
+        float t = sensor_fusion_read(fusion, monotonic_seconds());
+        time_t now = time(NULL);
+
+        // 没有有效读数时连续失败达到 failsafe_reads 次中止
+        if (t == -1.0) {
+            if (++bad_reads >= (failsafe_reads > 0 ? failsafe_reads : 1)) {
+                fprintf(stderr, "Autotune aborted: no valid temperature reading\n");
+                set_fanspeed(failsafe_speed, fan_pwm_file);
+                return -1;
+            }
+            sleep(1);
+            continue;
+        }
+        bad_reads = 0;
+
+        if (critical_temp > 0 && (fusion->hottest >= critical_temp || t >= critical_temp)) {
+            fprintf(stderr, "Autotune aborted: temperature %.1f°C reached critical %d°C\n", fusion->hottest, critical_temp);
+            set_fanspeed(max_speed, fan_pwm_file);
+            return -1;
+        }
+        if (t >= temp_limit) {
+            fprintf(stderr, "Autotune aborted: temperature %.1f°C above limit %.0f°C\n", t, temp_limit);
+            set_fanspeed(max_speed, fan_pwm_file);
+            return -1;
+        }
+        if (difftime(now, start) > autotune_timeout) {
+            fprintf(stderr, "Autotune failed: no stable oscillation within %d seconds\n", autotune_timeout);
+            set_fanspeed(max_speed, fan_pwm_file);
+            return -1;
+        }
+
+        if (t > cyc_max) cyc_max = t;
+        if (t < cyc_min) cyc_min = t;
+
+        // 温度向上穿过目标温度时切换到高输出，并结束一个振荡周期
+        if (!relay_on && t > target_temp + AUTOTUNE_HYST) {
+            relay_on = 1;
+            if (last_cross != 0) {
+                periods[cycles] = difftime(now, last_cross);
+                amps[cycles] = (cyc_max - cyc_min) / 2.0;
+                cycles++;
+            }
+            last_cross = now;
+            cyc_max = cyc_min = t;
+        } else if (relay_on && t < target_temp - AUTOTUNE_HYST) {
+            relay_on = 0;
+        }
+
+        int pwm = output_to_pwm(relay_on ? high : low, max_speed, start_speed);
+        set_fanspeed(stall_monitor_update(&stall, pwm, get_fanspeed(fan_speed_file), now), fan_pwm_file);
+        sleep(1);
+    }
+
+    // 丢弃第一个周期（初始瞬态），其余取平均
+    float tu = 0.0, a = 0.0;
+    for (int i = 1; i < AUTOTUNE_CYCLES; i++) {
+        tu += periods[i];
+        a += amps[i];
+    }
+    tu /= AUTOTUNE_CYCLES - 1;
+    a /= AUTOTUNE_CYCLES - 1;
+    if (a <= AUTOTUNE_HYST || tu <= 0.0) {
+        fprintf(stderr, "Autotune failed: oscillation too small (%.2f°C)\n", a);
+        set_fanspeed(max_speed, fan_pwm_file);
+        return -1;
+    }
+
+    float ku = 4.0 * d / (M_PI * sqrtf(a * a - AUTOTUNE_HYST * AUTOTUNE_HYST));
+    float kp, ki, kd;
+    autotune_gains(autotune_rule, ku, tu, a, d, &kp, &ki, &kd);
+    fprintf(stderr, "Autotune done: Ku=%.2f Tu=%.0fs a=%.2f°C -> Kp=%.3f Ki=%.5f Kd=%.4f\n", ku, tu, a, kp, ki, kd);
+
+    Kp = kp;
+    Ki = ki;
+    Kd = kd;
+    autotune_save(kp, ki, kd);
+    return 0;
+}
+
+/**
+ * 执行继电反馈自整定
+ * 无论成功、中止还是超时都清除UCI中的autotune标志，避免每次启动重新运行
+ * @return 成功返回0，失败返回-1
+ */
+static int autotune_run(void) {
+    if (!autotune_rule_valid(autotune_rule)) {
+        fprintf(stderr, "Autotune failed: unknown rule '%s' (zn, tl, simc)\n", autotune_rule);
+        autotune_clear();
+        return -1;
+    }
+    static SensorFusion fusion;
+    sensor_fusion_init(&fusion);
+    int ret = autotune_relay(&fusion);
+    sysfs_batch_close(&fusion.io);
+    if (ret != 0) autotune_clear();
+    return ret;
+}
+
+/**
+ * CPU利用率采样
+ * /proc/stat 保持打开，每次从偏移0处 pread，避免每秒打开关闭文件
+ */
+typedef struct {
+    int fd;                                     // /proc/stat 文件描述符
+    unsigned long long prev_busy[CPU_MAX + 1];  // 上一次忙碌时间（[0]为总体）
+    unsigned long long prev_total[CPU_MAX + 1]; // 上一次总时间
+    float util;                                 // 总体利用率 (0-1)
+    float util_max;                             // 最忙单核利用率 (0-1)
+    float gain;                                 // 当前前馈增益（%，可在线学习）
+} CPUSampler;
+
+void cpu_sampler_init(CPUSampler *cpu) {
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->fd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    cpu->gain = ff_cpu_gain;
+}
+
+/**
+ * 读取 /proc/stat 并更新利用率
+ * @return 成功返回0，失败返回-1
+ */
+int cpu_sampler_update(CPUSampler *cpu) {
+    char buf[4096];
+    ssize_t len;
+
+    if (cpu->fd < 0) return -1;
+    len = pread(cpu->fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0) return -1;
+    buf[len] = '\0';
+
+    float util_max = 0.0;
+    char *line = buf;
+    while (strncmp(line, "cpu", 3) == 0) {
+        int idx = 0;
+        char *p = line + 3;
+        // "cpu " 为总体，"cpuN " 为第N个核
+        if (isdigit((unsigned char)*p)) {
+            idx = atoi(p) + 1;
+            while (isdigit((unsigned char)*p)) p++;
+        }
+
+        unsigned long long v[8] = { 0 };
+        sscanf(p, "%llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+        unsigned long long total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+        unsigned long long busy = total - v[3] - v[4];   // 去掉 idle 和 iowait
+
+        if (idx <= CPU_MAX) {
+            unsigned long long dt = total - cpu->prev_total[idx];
+            float u = 0.0;
+            if (cpu->prev_total[idx] != 0 && dt > 0) {
+                u = (float)(busy - cpu->prev_busy[idx]) / dt;
+            }
+            cpu->prev_busy[idx] = busy;
+            cpu->prev_total[idx] = total;
+            if (idx == 0) cpu->util = u;
+            else if (u > util_max) util_max = u;
+        }
+
+        line = strchr(line, '\n');
+        if (line == NULL) break;
+        line++;
+    }
+    cpu->util_max = util_max;
+    return 0;
+}
+
+/**
+ * 计算CPU负载前馈输出
+ * @return 附加的风扇输出（%）
+ */
+float cpu_feedforward(const CPUSampler *cpu) {
+    float u = strcmp(ff_cpu_source, "max_core") == 0 ? cpu->util_max : cpu->util;
+    return cpu->gain * u;
+}
+
+/**
+ * 在线学习前馈增益（在每次PID计算后调用）
+ * 积分项代表反馈仍需补偿的稳态输出，将与负载相关的部分逐步转移到前馈，
+ * 同时从积分项中扣除相同的量，保证输出连续
+ */
+void cpu_feedforward_learn(CPUSampler *cpu, PIDController *pid) {
+    float u = strcmp(ff_cpu_source, "max_core") == 0 ? cpu->util_max : cpu->util;
+    if (u <= 0.05) return;
+
+    float delta = ff_cpu_learn_rate * pid->integral * u;
+    float limit = ff_cpu_gain > 0 ? ff_cpu_gain * 2.0 : 100.0;
+    if (cpu->gain + delta > limit) delta = limit - cpu->gain;
+    if (cpu->gain + delta < 0.0) delta = -cpu->gain;
+
+    cpu->gain += delta;
+    pid->integral -= delta * u;
+    pid->feedforward += delta * u;
+}
+
+/**
+ * 网络流量和无线射频忙碌度采样
+ * /proc/net/dev 保持打开并用 pread 读取；逐行只比较设备名，
+ * 只有配置的接口才解析计数器，其余行直接跳到下一行
+ */
+typedef struct {
+    int fd;                                 // /proc/net/dev 文件描述符
+    int airtime_fd[AIRTIME_MAX];            // 射频忙碌时间文件描述符
+    unsigned long long prev_bytes;          // 上一次收发字节总数
+    unsigned long long prev_packets;        // 上一次收发包总数
+    unsigned long long prev_busy[AIRTIME_MAX];  // 上一次射频忙碌时间（微秒）
+    double prev_time;                       // 上一次采样时间（秒，单调时钟）
+    float mbps;                             // 收发总速率（Mbit/s）
+    float kpps;                             // 收发总包率（千包/秒）
+    float airtime;                          // 最忙射频的忙碌比例 (0-1)
+} NetSampler;
+
+void net_sampler_init(NetSampler *net) {
+    memset(net, 0, sizeof(*net));
+    net->fd = ff_net_iface_count > 0 ? open("/proc/net/dev", O_RDONLY | O_CLOEXEC) : -1;
+    for (int i = 0; i < AIRTIME_MAX; i++) {
+        net->airtime_fd[i] = i < ff_airtime_count ? open(ff_airtime_file[i], O_RDONLY | O_CLOEXEC) : -1;
+    }
+}
+
+void net_sampler_close(NetSampler *net) {
+    if (net->fd >= 0) close(net->fd);
+    for (int i = 0; i < AIRTIME_MAX; i++) {
+        if (net->airtime_fd[i] >= 0) close(net->airtime_fd[i]);
+    }
+}
+
+/**
+ * 更新流量和射频忙碌度
+ */
+void net_sampler_update(NetSampler *net) {
+    char buf[8192];
+    double now = monotonic_seconds();
+    double dt = now - net->prev_time;
+    int first = net->prev_time == 0.0;
+    net->prev_time = now;
+
+    if (net->fd >= 0) {
+        ssize_t len = pread(net->fd, buf, sizeof(buf) - 1, 0);
+        if (len > 0) {
+            buf[len] = '\0';
+            unsigned long long bytes = 0, packets = 0;
+            char *line = buf;
+            while ((line = strchr(line, '\n')) != NULL) {
+                line++;
+                while (*line == ' ') line++;
+                char *eol = strchr(line, '\n');
+                char *colon = memchr(line, ':', eol ? (size_t)(eol - line) : strlen(line));
+                if (colon == NULL) continue;
+                size_t name_len = colon - line;
+                for (int i = 0; i < ff_net_iface_count; i++) {
+                    if (strlen(ff_net_iface[i]) == name_len && strncmp(line, ff_net_iface[i], name_len) == 0) {
+                        // 接收：字节 包 ... 共8列；发送：字节 包 ...
+                        unsigned long long v[10] = { 0 };
+                        sscanf(colon + 1, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                            &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9]);
+                        bytes += v[0] + v[8];
+                        packets += v[1] + v[9];
+                        break;
+                    }
+                }
+                line = colon;
+            }
+            if (!first && dt > 0.0 && bytes >= net->prev_bytes && packets >= net->prev_packets) {
+                net->mbps = (bytes - net->prev_bytes) * 8.0 / 1e6 / dt;
+                net->kpps = (packets - net->prev_packets) / 1e3 / dt;
+            }
+            net->prev_bytes = bytes;
+            net->prev_packets = packets;
+        }
+    }
+
+    float airtime = 0.0;
+    for (int i = 0; i < AIRTIME_MAX; i++) {
+        if (net->airtime_fd[i] < 0) continue;
+        ssize_t len = pread(net->airtime_fd[i], buf, 63, 0);
+        if (len <= 0) continue;
+        buf[len] = '\0';
+        unsigned long long busy = strtoull(buf, NULL, 10);
+        if (!first && dt > 0.0 && busy >= net->prev_busy[i]) {
+            float a = (busy - net->prev_busy[i]) / 1e6 / dt;
+            if (a > 1.0) a = 1.0;
+            if (a > airtime) airtime = a;
+        }
+        net->prev_busy[i] = busy;
+    }
+    net->airtime = airtime;
+}
+
+/**
+ * 计算网络流量前馈输出：增益表分段线性插值加射频忙碌度
+ * @return 附加的风扇输出（%）
+ */
+float net_feedforward(const NetSampler *net) {
+    float out = 0.0;
+    float x = strcmp(ff_net_metric, "kpps") == 0 ? net->kpps : net->mbps;
+
+    if (ff_net_points > 0) {
+        if (x <= ff_net_rate[0]) {
+            out = ff_net_rate[0] > 0 ? ff_net_output[0] * x / ff_net_rate[0] : ff_net_output[0];
+        } else {
+            out = ff_net_output[ff_net_points - 1];
+            for (int i = 1; i < ff_net_points; i++) {
+                if (x <= ff_net_rate[i]) {
+                    float span = ff_net_rate[i] - ff_net_rate[i - 1];
+                    out = span > 0 ? ff_net_output[i - 1] + (ff_net_output[i] - ff_net_output[i - 1]) * (x - ff_net_rate[i - 1]) / span
+                                   : ff_net_output[i];
+                    break;
+                }
+            }
+        }
+    }
+    return out + ff_airtime_gain * net->airtime;
+}
+
+/**
+ * 在线热模型辨识（一阶惯性加纯滞后，FOPDT）
+ * 每秒一个样本，离散模型：T[k] = a·T[k-1] + b·u[k-1-d] + c·L[k-1] + e
+ * 其中u为风扇输出（%），L为CPU利用率，e吸收环境温度。
+ * 对每个候选滞后d各运行一个带遗忘因子的递推最小二乘（RLS），取预测误差最小者。
+ * 时间常数 τ = -1/ln(a)，增益 K = b/(1-a)（°C/%），负载增益 = c/(1-a)。
+ */
+#define MODEL_PARAMS 4              // 模型参数个数
+#define MODEL_HISTORY 33            // 输出历史长度（秒），覆盖最大候选滞后
+#define MODEL_LAMBDA 0.999          // RLS遗忘因子
+#define MODEL_P0 100.0              // 协方差初值
+#define MODEL_P_MAX 1e6             // 协方差迹上限，防止激励不足时发散
+#define MODEL_MIN_SAMPLES 600       // 模型可用前的最少样本数
+#define MODEL_ADAPT_INTERVAL 300    // 自适应调整PID参数的间隔（秒）
+
+static const int model_delays[] = { 0, 1, 2, 4, 8, 16, 32 };
+#define MODEL_DELAYS (int)(sizeof(model_delays) / sizeof(model_delays[0]))
+
+typedef struct {
+    double theta[MODEL_PARAMS];             // 参数 [a, b, c, e]
+    double P[MODEL_PARAMS][MODEL_PARAMS];   // 协方差矩阵
+    double err;                             // 预测误差平方的指数平均
+} RLSEstimator;
+
+typedef struct {
+    RLSEstimator est[MODEL_DELAYS];     // 每个候选滞后一个估计器
+    float u_hist[MODEL_HISTORY];        // 风扇输出历史环形缓冲区
+    int u_head;                         // 最新输出位置
+    float prev_temp;                    // 上一个温度样本
+    float prev_load;                    // 上一个负载样本
+    long samples;                       // 已处理样本数
+    int best;                           // 当前最优候选
+    // 当前模型（valid为0时无效）
+    int valid;
+    float tau;                          // 时间常数（秒）
+    float gain;                         // 风扇输出增益（°C/%）
+    float load_gain;                    // 负载增益（°C/满载）
+    int dead_time;                      // 纯滞后（秒）
+} ThermalModel;
+
+static void rls_reset(RLSEstimator *est) {
+    memset(est, 0, sizeof(*est));
+    est->theta[0] = 1.0;
+    for (int i = 0; i < MODEL_PARAMS; i++) est->P[i][i] = MODEL_P0;
+}
+
+void model_init(ThermalModel *m) {
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < MODEL_DELAYS; i++) rls_reset(&m->est[i]);
+}
+
+static void rls_update(RLSEstimator *est, const double *phi, double y) {
+    double Pphi[MODEL_PARAMS], k[MODEL_PARAMS];
+    double denom = MODEL_LAMBDA, pred = 0.0, trace = 0.0;
+
+    for (int i = 0; i < MODEL_PARAMS; i++) {
+        Pphi[i] = 0.0;
+        for (int j = 0; j < MODEL_PARAMS; j++) Pphi[i] += est->P[i][j] * phi[j];
+        denom += phi[i] * Pphi[i];
+        pred += est->theta[i] * phi[i];
+    }
+
+    double e = y - pred;
+    est->err = 0.99 * est->err + 0.01 * e * e;
+
+    for (int i = 0; i < MODEL_PARAMS; i++) {
+        k[i] = Pphi[i] / denom;
+        est->theta[i] += k[i] * e;
+    }
+    for (int i = 0; i < MODEL_PARAMS; i++) {
+        for (int j = 0; j < MODEL_PARAMS; j++) {
+            est->P[i][j] = (est->P[i][j] - k[i] * Pphi[j]) / MODEL_LAMBDA;
+        }
+        trace += est->P[i][i];
+    }
+
+    // 长时间激励不足时遗忘因子会使协方差发散，超过上限时整体缩小
+    if (trace > MODEL_P_MAX) {
+        for (int i = 0; i < MODEL_PARAMS; i++)
+            for (int j = 0; j < MODEL_PARAMS; j++) est->P[i][j] *= MODEL_P_MAX / trace;
+    }
+}
+
+/**
+ * 输入一个样本（每秒一次）
+ * @param m 模型
+ * @param temp 当前温度（已滤波）
+ * @param u 上一秒内施加的风扇输出（%）
+ * @param load 当前系统负载
+ */
+void model_update(ThermalModel *m, float temp, float u, float load) {
+    m->u_head = (m->u_head + 1) % MODEL_HISTORY;
+    m->u_hist[m->u_head] = u;
+
+    if (m->samples > 0) {
+        for (int i = 0; i < MODEL_DELAYS; i++) {
+            int idx = (m->u_head - model_delays[i] + MODEL_HISTORY) % MODEL_HISTORY;
+            double phi[MODEL_PARAMS] = { m->prev_temp, m->u_hist[idx], m->prev_load, 1.0 };
+            rls_update(&m->est[i], phi, temp);
+        }
+    }
+    m->prev_temp = temp;
+    m->prev_load = load;
+    m->samples++;
+
+    // 选取预测误差最小的候选滞后
+    m->best = 0;
+    for (int i = 1; i < MODEL_DELAYS; i++) {
+        if (m->est[i].err < m->est[m->best].err) m->best = i;
+    }
+
+    const double *th = m->est[m->best].theta;
+    m->valid = 0;
+    if (m->samples >= MODEL_MIN_SAMPLES && th[0] > 0.0 && th[0] < 1.0) {
+        m->tau = -1.0 / log(th[0]);
+        m->gain = th[1] / (1.0 - th[0]);
+        m->load_gain = th[2] / (1.0 - th[0]);
+        m->dead_time = model_delays[m->best];
+        // 风扇输出增大应使温度降低
+        m->valid = m->tau > 1.0 && m->tau < 3600.0 && m->gain < 0.0;
+    }
+}
+
+/**
+ * 写出当前模型参数，供界面和脚本读取
+ */
+void model_write_status(const ThermalModel *m) {
+    FILE *fp = fopen(MODEL_FILE, "w");
+    if (fp == NULL) return;
+    fprintf(fp, "valid=%d\nsamples=%ld\ntau=%.1f\ngain=%.4f\nload_gain=%.4f\ndead_time=%d\n",
+        m->valid, m->samples, m->tau, m->gain, m->load_gain, m->dead_time);
+    fclose(fp);
+}
+
+/**
+ * 根据模型按SIMC规则计算PID参数，并限制在配置值的安全范围内
+ * Kc = τ / (|K|·(τc+θ))，τI = min(τ, 4(τc+θ))，取 τc = max(θ, pid_interval)
+ */
+void model_adapt_gains(const ThermalModel *m, float *kp, float *ki, float *kd) {
+    float step = pid_interval > 0 ? pid_interval : 1;
+    float tc = m->dead_time > step ? m->dead_time : step;
+    float kc = m->tau / (-m->gain * (tc + m->dead_time));
+    float ti = 4.0 * (tc + m->dead_time);
+    if (ti > m->tau) ti = m->tau;
+    if (ti < step) ti = step;
+
+    float range = model_adapt_range > 1.0 ? model_adapt_range : 1.0;
+    *kp = fminf(fmaxf(kc, Kp / range), Kp * range);
+    *ki = fminf(fmaxf(kc / ti, Ki / range), Ki * range);
+    *kd = Kd;
+}
+
+// 记录温度日志，interval 为调用方读取的日志记录间隔
+void log_temperature(float current_temp, int interval) {
+    // 确保 /tmp/log/ 目录存在
+    mkdir("/tmp/log", 0755);
+
+    // 读取现有日志内容
+    FILE *log_file = fopen("/tmp/log/log.fancontrol_temp", "r");
+    char **lines = NULL;
+    size_t line_count = 0;
+    char line[256];
+    
+    if (log_file) {
+        // 读取所有现有行
+        while (fgets(line, sizeof(line), log_file) != NULL) {
+            lines = realloc(lines, (line_count + 1) * sizeof(char*));
+            lines[line_count] = strdup(line);
+            line_count++;
+        }
+        fclose(log_file);
+    }
+
+    // 生成新的日志行（最新的在最前面）
+    time_t now;
+    time(&now);
+    char time_str[20];
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    char new_line[256];
+    snprintf(new_line, sizeof(new_line), "[%s] %.1f\n", time_str, current_temp);
+
+    // 根据温度记录间隔计算1小时最多记录的条目数
+    // 1小时 = 3600秒，除以记录间隔得到最大条目数
+    const size_t max_lines = (interval > 0) ? (3600 / interval) : 360;
+    
+    // 重新打开文件写入（最新的在最前面）
+    log_file = fopen("/tmp/log/log.fancontrol_temp", "w");
+    if (log_file) {
+        // 先写入新记录（最新的在最前面）
+        fputs(new_line, log_file);
+        
+        // 然后写入现有记录，但不超过最大限制
+        size_t lines_to_write = (line_count < max_lines - 1) ? line_count : max_lines - 1;
+        for (size_t i = 0; i < lines_to_write; i++) {
+            fputs(lines[i], log_file);
+            free(lines[i]);
+        }
+        
+        // 释放剩余的内存
+        for (size_t i = lines_to_write; i < line_count; i++) {
+            free(lines[i]);
+        }
+        
+        if (lines) free(lines);
+        fclose(log_file);
+    } else {
+        // 如果写入失败，释放内存
+        for (size_t i = 0; i < line_count; i++) {
+            free(lines[i]);
+        }
+        if (lines) free(lines);
+    }
+}
+
+/**
+ * 采样记录：控制线程每个周期生成一条，经环形队列交给遥测线程
+ */
+typedef struct {
+    double time;            // 单调时钟（秒）
+    time_t wall;            // 系统时间
+    float temperature;      // 滤波/融合后的温度（°C）
+    int16_t setpoint;       // 当前目标温度（°C）
+    int16_t request;        // 控制器给定的PWM（整形前）
+    int16_t pwm;            // 写入的PWM
+    int16_t flags;          // FC_FLAG_* 标志
+    int32_t rpm;            // 风扇转速，-1表示无反馈
+} SampleRecord;
+
+/**
+ * 单生产者/单消费者无锁环形队列
+ * 生产者只写 head，消费者只写 tail，两者放在不同缓存行；队列满时丢弃新记录并计数，生产者从不等待
+ */
+typedef struct {
+    uint32_t head;
+    char pad1[60];
+    uint32_t tail;
+    char pad2[60];
+    uint32_t dropped;       // 队列满时丢弃的记录数
+    SampleRecord rec[SAMPLE_RING_SIZE];
+} SampleRing;
+
+/**
+ * 写入一条记录（仅控制线程调用）
+ * @return 成功返回0，队列满返回-1
+ */
+int sample_ring_push(SampleRing *ring, const SampleRecord *rec) {
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= SAMPLE_RING_SIZE) {
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    ring->rec[head & (SAMPLE_RING_SIZE - 1)] = *rec;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * 取出一条记录（仅遥测线程调用）
+ * @return 取到返回1，队列空返回0
+ */
+int sample_ring_pop(SampleRing *ring, SampleRecord *rec) {
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head == tail) return 0;
+    *rec = ring->rec[tail & (SAMPLE_RING_SIZE - 1)];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static SampleRing sample_ring;
+static volatile sig_atomic_t trace_requested = 0;
+
+/**
+ * 控制命令：从控制套接字收到，经单生产者/单消费者队列交给控制线程执行
+ */
+#define CONTROL_SET 1           // 修改运行参数
+#define CONTROL_CALIBRATE 2     // 重新标定风扇
+
+typedef struct {
+    int type;               // CONTROL_*
+    int tunable;            // 参数在 tunables 中的序号
+    float value;
+} ControlCommand;
+
+typedef struct {
+    uint32_t head;
+    char pad1[60];
+    uint32_t tail;
+    char pad2[60];
+    ControlCommand cmd[CONTROL_QUEUE_SIZE];
+} ControlQueue;
+
+static ControlQueue control_queue;
+
+// 写入一条命令（仅遥测线程调用），队列满返回-1
+int control_queue_push(ControlQueue *q, const ControlCommand *cmd) {
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= CONTROL_QUEUE_SIZE) return -1;
+    q->cmd[head & (CONTROL_QUEUE_SIZE - 1)] = *cmd;
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// 取出一条命令（仅控制线程调用），队列空返回0
+int control_queue_pop(ControlQueue *q, ControlCommand *cmd) {
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (head == tail) return 0;
+    *cmd = q->cmd[tail & (CONTROL_QUEUE_SIZE - 1)];
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * 可在运行时修改的参数（fancontrol-ctl set）
+ * 修改只在内存中生效，不写入UCI，重新加载配置后恢复为配置值
+ */
+typedef struct {
+    const char* name;       // 与UCI选项名相同
+    float* fvar;            // 浮点参数
+    int* ivar;              // 整数参数
+    float min;
+    float max;
+} Tunable;
+
+static const Tunable tunables[] = {
+    { "target_temp", NULL, &target_temp, 0, MAX_TEMP },
+    { "max_speed", NULL, &max_speed, 0, 255 },
+    { "start_speed", NULL, &start_speed, 0, 255 },
+    { "Kp", &Kp, NULL, 0, 1000 },
+    { "Ki", &Ki, NULL, 0, 1000 },
+    { "Kd", &Kd, NULL, 0, 1000 },
+    { "pid_interval", NULL, &pid_interval, 1, 3600 },
+    { "bang_hyst", &bang_hyst, NULL, 0, 20 },
+    { "pwm_slew_up", &pwm_slew_up, NULL, 0, 1000 },
+    { "pwm_slew_down", &pwm_slew_down, NULL, 0, 1000 },
+    { "pwm_deadband", NULL, &pwm_deadband, 0, 255 },
+    { "pwm_dwell", NULL, &pwm_dwell, 0, 3600 },
+};
+
+#define TUNABLE_COUNT (int)(sizeof(tunables) / sizeof(tunables[0]))
+
+static int tunable_find(const char* name) {
+    for (int i = 0; i < TUNABLE_COUNT; i++) {
+        if (strcmp(tunables[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// 修改参数（控制线程中执行），PID增益变化时无扰切换
+static void tunable_apply(const Tunable *t, float value) {
+    if (t->fvar) {
+        *t->fvar = value;
+    } else {
+        *t->ivar = (int)lroundf(value);
+    }
+    fprintf(stderr, "Runtime setting %s = %g\n", t->name, value);
+
+    PIDController* pid = controller_pid(&temp_ctrl);
+    if (pid && (t->fvar == &Kp || t->fvar == &Ki || t->fvar == &Kd)) {
+        PID_SetTunings(pid, Kp, Ki, Kd);
+    }
+}
+
+/**
+ * 数据点累加器：历史记录分级和查询时的降采样共用
+ */
+typedef struct {
+    int n;
+    float temperature;
+    float setpoint;
+    float pwm;
+    float request;
+    float rpm;
+    int rpm_n;              // 有转速反馈的点数
+    uint8_t flags;
+} PointSum;
+
+static void point_sum_add(PointSum *sum, const FcCtlPoint *p) {
+    sum->n++;
+    sum->temperature += p->temperature;
+    sum->setpoint += p->setpoint;
+    sum->pwm += p->pwm;
+    sum->request += p->request;
+    if (p->rpm != FC_CTL_NO_RPM) {
+        sum->rpm += p->rpm;
+        sum->rpm_n++;
+    }
+    sum->flags |= p->flags;
+}
+
+// 取出平均值并清空累加器
+static void point_sum_take(PointSum *sum, uint32_t time, FcCtlPoint *p) {
+    memset(p, 0, sizeof(*p));
+    p->time = time;
+    p->temperature = (int16_t)lroundf(sum->temperature / sum->n);
+    p->setpoint = (int16_t)lroundf(sum->setpoint / sum->n);
+    p->pwm = (uint8_t)lroundf(sum->pwm / sum->n);
+    p->request = (uint8_t)lroundf(sum->request / sum->n);
+    p->rpm = sum->rpm_n > 0 ? (uint16_t)lroundf(sum->rpm / sum->rpm_n) : FC_CTL_NO_RPM;
+    p->flags = sum->flags;
+    memset(sum, 0, sizeof(*sum));
+}
+
+// 采样记录转换为数据点
+static void sample_point(const SampleRecord *rec, FcCtlPoint *p) {
+    float temp = rec->temperature * 100;
+    memset(p, 0, sizeof(*p));
+    p->time = (uint32_t)rec->wall;
+    p->temperature = (int16_t)(temp > INT16_MAX ? INT16_MAX : temp < INT16_MIN ? INT16_MIN : lroundf(temp));
+    p->setpoint = (int16_t)(rec->setpoint * 100);
+    p->pwm = (uint8_t)(rec->pwm < 0 ? 0 : rec->pwm);
+    p->request = (uint8_t)(rec->request < 0 ? 0 : rec->request);
+    p->rpm = rec->rpm < 0 ? FC_CTL_NO_RPM : (uint16_t)(rec->rpm > 0xfffe ? 0xfffe : rec->rpm);
+    p->flags = (uint8_t)rec->flags;
+}
+
+/**
+ * 历史记录压缩块：块内的点按 fancontrol_history.h 的格式编码，每块可独立解码
+ */
+typedef struct {
+    uint32_t first;         // 第一个点的时间
+    uint32_t last;          // 最后一个点的时间
+    uint16_t len;           // 已用字节数
+    uint16_t count;         // 点数
+    uint8_t data[HISTORY_BLOCK_BYTES];
+} HistoryBlock;
+
+/**
+ * 历史记录分级：每级按固定时间段取平均，写入压缩块；块写满后封存，所有块用完时覆盖最早的块
+ */
+typedef struct {
+    int step;               // 每个点的秒数
+    int size;               // 保存的点数（按 HISTORY_POINT_BYTES 估计，用于选择分级）
+    HistoryBlock* block;    // 块（环形）
+    int blocks;             // 块数量，0表示未分配
+    int head;               // 正在写入的块
+    int used;               // 已使用的块数（含正在写入的块）
+    FcHistState enc;        // 正在写入的块的编码状态
+    uint32_t bucket;        // 正在累计的时间段的开始时间
+    PointSum sum;           // 正在累计的时间段
+} HistoryTier;
+
+static void history_init(HistoryTier *h) {
+    h->blocks = h->size * HISTORY_POINT_BYTES / (HISTORY_BLOCK_BYTES - FC_HIST_POINT_MAX) + 2;
+    h->block = calloc(h->blocks, sizeof(HistoryBlock));
+    if (h->block == NULL) {
+        fprintf(stderr, "Cannot allocate %d-second history, disabled\n", h->step);
+        h->blocks = 0;
+    }
+}
+
+// 追加一个点，当前块剩余空间不足时封存并开始下一块
+static void history_append(HistoryTier *h, const FcCtlPoint *p) {
+    HistoryBlock *b = &h->block[h->head];
+    if (h->used == 0) {
+        h->used = 1;
+    } else if (b->len + FC_HIST_POINT_MAX > HISTORY_BLOCK_BYTES) {
+        h->head = (h->head + 1) % h->blocks;
+        if (h->used < h->blocks) h->used++;
+        b = &h->block[h->head];
+        b->len = 0;
+        b->count = 0;
+        memset(&h->enc, 0, sizeof(h->enc));
+    }
+    if (b->count == 0) b->first = p->time;
+    b->len += fc_hist_encode(&h->enc, p, b->data + b->len);
+    b->count++;
+    b->last = p->time;
+}
+
+static void history_add(HistoryTier *h, const FcCtlPoint *p) {
+    if (h->blocks == 0) return;
+    uint32_t bucket = p->time - p->time % h->step;
+    if (h->sum.n > 0 && bucket != h->bucket) {
+        FcCtlPoint avg;
+        point_sum_take(&h->sum, h->bucket, &avg);
+        history_append(h, &avg);
+    }
+    h->bucket = bucket;
+    point_sum_add(&h->sum, p);
+}
+
+/**
+ * 长期时序存储（见 fancontrol_tsdb.h），未启用或创建失败时为NULL
+ */
+static FcTsdbHeader *tsdb = NULL;
+static FcTsdbState tsdb_state;      // 正在写入的块的编码状态
+static int tsdb_opened_size = 0;    // 当前打开的存储对应的 tsdb_size（KiB），重新加载后不同时重新打开
+
+static FcTsdbBlock* tsdb_block(uint32_t i) {
+    return (FcTsdbBlock*)fc_tsdb_block(tsdb, i);
+}
+
+// 清空一个块并开始写入
+static void tsdb_start_block(uint32_t i) {
+    FcTsdbBlock *b = tsdb_block(i);
+    fc_tsdb_write_begin(b);
+    __atomic_store_n(&b->count, 0, __ATOMIC_RELAXED);
+    b->bits = 0;
+    b->first = 0;
+    b->last = 0;
+    b->sealed = 0;
+    memset(b->data, 0, sizeof(b->data));
+    fc_tsdb_write_end(b);
+    __atomic_store_n(&tsdb->head, i, __ATOMIC_RELEASE);
+    memset(&tsdb_state, 0, sizeof(tsdb_state));
+}
+
+/**
+ * 创建并映射存储文件（只由写入方调用：遥测线程，或启动时的控制线程）
+ * 大小不变时保留已有数据：封存上次正在写入的块，从下一块开始
+ * @param size_kb 存储大小（KiB），0表示不启用
+ */
+void tsdb_open(int size_kb) {
+    tsdb_opened_size = size_kb;
+    if (size_kb <= 0) return;
+    uint32_t blocks = (uint32_t)size_kb * 1024 / FC_TSDB_BLOCK_SIZE;
+    if (blocks < 2) blocks = 2;
+    size_t size = fc_tsdb_file_size(blocks);
+
+    int fd = open(FC_TSDB_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0 ||
+        ((size_t)sb.st_size != size && (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0))) {
+        fprintf(stderr, "Cannot create time series store %s: %s\n", FC_TSDB_FILE, strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "Cannot map time series store %s: %s\n", FC_TSDB_FILE, strerror(errno));
+        return;
+    }
+    tsdb = p;
+
+    if (tsdb->magic == FC_TSDB_MAGIC && tsdb->version == FC_TSDB_VERSION &&
+        tsdb->block_size == FC_TSDB_BLOCK_SIZE && tsdb->blocks == blocks && tsdb->head < blocks) {
+        // 上次在回收块的中途退出时该块的序号为奇数，读取方会一直重试；内容不完整，清空后恢复为偶数
+        for (uint32_t i = 0; i < blocks; i++) {
+            FcTsdbBlock *b = tsdb_block(i);
+            uint32_t seq = __atomic_load_n(&b->seq, __ATOMIC_RELAXED);
+            if (seq & 1) {
+                __atomic_store_n(&b->count, 0, __ATOMIC_RELAXED);
+                b->sealed = 0;
+                __atomic_store_n(&b->seq, seq + 1, __ATOMIC_RELEASE);
+            }
+        }
+        tsdb_block(tsdb->head)->sealed = 1;
+        tsdb->daemon_pid = getpid();
+        tsdb_start_block((tsdb->head + 1) % blocks);
+        return;
+    }
+    for (uint32_t i = 0; i < blocks; i++) {
+        tsdb_block(i)->seq = 0;
+        __atomic_store_n(&tsdb_block(i)->count, 0, __ATOMIC_RELAXED);
+    }
+    tsdb->magic = FC_TSDB_MAGIC;
+    tsdb->version = FC_TSDB_VERSION;
+    tsdb->block_size = FC_TSDB_BLOCK_SIZE;
+    tsdb->blocks = blocks;
+    tsdb->daemon_pid = getpid();
+    tsdb_start_block(0);
+}
+
+// 解除映射（文件保留，读取方仍可读取已有数据）
+static void tsdb_close(void) {
+    if (tsdb == NULL) return;
+    tsdb_block(tsdb->head)->sealed = 1;
+    munmap(tsdb, fc_tsdb_file_size(tsdb->blocks));
+    tsdb = NULL;
+}
+
+/**
+ * 追加一个点，当前块剩余空间不足时封存并回收最早的块
+ */
+static void tsdb_append(const FcTsdbPoint *p) {
+    FcTsdbBlock *b = tsdb_block(tsdb->head);
+    if (b->bits + FC_TSDB_POINT_BITS_MAX > sizeof(b->data) * 8) {
+        b->sealed = 1;
+        tsdb_start_block((tsdb->head + 1) % tsdb->blocks);
+        b = tsdb_block(tsdb->head);
+    }
+    uint32_t bits = b->bits;
+    fc_tsdb_encode(&tsdb_state, p, b->data, &bits);
+    if (b->count == 0) b->first = p->time;
+    b->last = p->time;
+    b->bits = bits;
+    __atomic_store_n(&b->count, b->count + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 控制套接字连接
+ * 应答和订阅者（watch）的数据点都先放入连接自己的缓冲区，套接字可写时再发送，
+ * 遥测线程从不等待某个连接，控制循环和其他连接不受慢速读取方影响
+ */
+typedef struct {
+    int fd;                 // -1表示空闲
+    uint32_t len;           // 已收到的字节数
+    unsigned char buf[sizeof(FcCtlHeader) + sizeof(FcCtlSetReq)];
+
+    unsigned char* reply;   // 待发送的应答（含消息头），NULL表示没有
+    uint32_t reply_len;
+    uint32_t reply_sent;    // 已发送的字节数
+    double reply_since;     // 应答生成的时间（单调时钟，秒）
+
+    int watch;              // 是否订阅实时数据
+    int decimation;         // 每多少个周期推送一个点
+    int policy;             // 队列满时的处理方式（FC_CTL_COALESCE/FC_CTL_DISCONNECT）
+    PointSum sum;           // 正在累计的点
+    uint32_t sum_time;      // 正在累计的点的开始时间
+    FcCtlPoint* queue;      // 待发送的点（环形队列）
+    int queue_size;
+    int queue_head;         // 队首位置
+    int queue_count;
+    unsigned char out[sizeof(FcCtlHeader) + sizeof(FcCtlPoint)];   // 正在发送的消息
+    uint32_t out_len;
+    uint32_t out_sent;      // 已发送的字节数
+} CtlClient;
+
+/**
+ * 遥测状态：跟踪缓冲区保存最近 TRACE_SIZE 条记录（收到SIGUSR1时导出），
+ * 历史记录按10秒/1分钟/10分钟分级压缩保存约6小时/7天/30天
+ */
+typedef struct {
+    SampleRecord trace[TRACE_SIZE];
+    int trace_pos;              // 下一个写入位置
+    int trace_count;            // 已保存的记录数
+    time_t last_log;            // 上次写温度日志的时间
+    time_t last_tsdb;           // 上次写入长期存储的时间
+    HistoryTier tier[HISTORY_TIERS];
+    CtlClient client[CTL_CLIENTS_MAX];
+} Telemetry;
+
+static Telemetry telemetry = {
+    .tier = {
+        { .step = 10, .size = 6 * 360 },
+        { .step = 60, .size = 7 * 1440 },
+        { .step = 600, .size = 30 * 144 },
+    },
+};
+
+// 导出跟踪缓冲区（最早的在前）
+static void telemetry_dump_trace(const Telemetry *t) {
+    FILE *fp = fopen(TRACE_FILE, "w");
+    if (fp == NULL) return;
+    fprintf(fp, "# time temperature setpoint request pwm rpm flags\n");
+    int start = (t->trace_pos - t->trace_count + TRACE_SIZE) % TRACE_SIZE;
+    for (int i = 0; i < t->trace_count; i++) {
+        const SampleRecord *r = &t->trace[(start + i) % TRACE_SIZE];
+        fprintf(fp, "%ld %.2f %d %d %d %d 0x%02x\n", (long)r->wall, r->temperature, r->setpoint,
+            r->request, r->pwm, (int)r->rpm, (unsigned)r->flags);
+    }
+    fclose(fp);
+}
+
+/**
+ * 历史数据来源：0为跟踪缓冲区（每秒一点），1..HISTORY_TIERS 为各级历史记录
+ */
+static int telemetry_source_step(const Telemetry *t, int src) {
+    return src == 0 ? 1 : t->tier[src - 1].step;
+}
+
+static int telemetry_source_size(const Telemetry *t, int src) {
+    return src == 0 ? TRACE_SIZE : t->tier[src - 1].size;
+}
+
+/**
+ * 按时间顺序扫描一个来源中不早于 from 的点，整块早于 from 的压缩块不解码
+ */
+typedef struct {
+    const Telemetry *t;
+    int src;
+    uint32_t from;
+    int index;              // 跟踪缓冲区中的序号，或已扫描的块数
+    size_t pos;             // 当前块中的读取位置
+    FcHistState dec;        // 当前块的解码状态
+} HistoryScan;
+
+static int history_scan_next(HistoryScan *s, FcCtlPoint *p) {
+    const Telemetry *t = s->t;
+    if (s->src == 0) {
+        int start = (t->trace_pos - t->trace_count + TRACE_SIZE) % TRACE_SIZE;
+        while (s->index < t->trace_count) {
+            sample_point(&t->trace[(start + s->index++) % TRACE_SIZE], p);
+            if (p->time >= s->from) return 1;
+        }
+        return 0;
+    }
+
+    const HistoryTier *h = &t->tier[s->src - 1];
+    while (s->index < h->used) {
+        const HistoryBlock *b = &h->block[(h->head - h->used + 1 + s->index + h->blocks) % h->blocks];
+        if (s->pos > 0 || b->last >= s->from) {
+            int ret;
+            while ((ret = fc_hist_decode(&s->dec, b->data, b->len, &s->pos, p)) == 1) {
+                if (p->time >= s->from) return 1;
+            }
+        }
+        s->index++;
+        s->pos = 0;
+        memset(&s->dec, 0, sizeof(s->dec));
+    }
+    return 0;
+}
+
+/**
+ * 查询历史记录：选择能覆盖时间范围的最细一级数据，按分辨率取平均后编码
+ * @param t 遥测状态
+ * @param now 当前系统时间
+ * @param range 时间范围（秒）
+ * @param resolution 分辨率（秒），小于数据本身分辨率时使用数据本身的分辨率
+ * @param out 输出缓冲区
+ * @param cap 输出缓冲区大小（字节）
+ * @return 输出的字节数
+ */
+static size_t telemetry_history(const Telemetry *t, uint32_t now, uint32_t range, uint32_t resolution, uint8_t *out, size_t cap) {
+    HistoryScan scan = { .t = t, .src = HISTORY_TIERS };
+    for (int i = 0; i <= HISTORY_TIERS; i++) {
+        if ((uint32_t)(telemetry_source_step(t, i) * telemetry_source_size(t, i)) >= range) {
+            scan.src = i;
+            break;
+        }
+    }
+    uint32_t step = telemetry_source_step(t, scan.src);
+    if (resolution < step) resolution = step;
+    scan.from = range < now ? now - range : 0;
+
+    FcHistState enc = { 0 };
+    PointSum sum = { 0 };
+    uint32_t bucket = 0;
+    size_t len = 0;
+    FcCtlPoint p, avg;
+    while (history_scan_next(&scan, &p) && len + FC_HIST_POINT_MAX <= cap) {
+        uint32_t b = p.time - p.time % resolution;
+        if (sum.n > 0 && b != bucket) {
+            point_sum_take(&sum, bucket, &avg);
+            len += fc_hist_encode(&enc, &avg, out + len);
+        }
+        bucket = b;
+        point_sum_add(&sum, &p);
+    }
+    if (sum.n > 0 && len + FC_HIST_POINT_MAX <= cap) {
+        point_sum_take(&sum, bucket, &avg);
+        len += fc_hist_encode(&enc, &avg, out + len);
+    }
+    return len;
+}
+
+static void ctl_close(CtlClient *c) {
+    close(c->fd);
+    free(c->reply);
+    free(c->queue);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+/**
+ * 开始订阅
+ * @return 结果码
+ */
+static int ctl_subscribe(CtlClient *c, const FcCtlHeader *hdr, const unsigned char *payload) {
+    FcCtlWatchReq req = { 0 };
+    if (hdr->len == sizeof(req)) {
+        memcpy(&req, payload, sizeof(req));
+    } else if (hdr->len != 0) {
+        return FC_CTL_EINVAL;
+    }
+    int size = req.queue > 0 ? req.queue : FC_CTL_QUEUE_DEFAULT;
+    if (size > FC_CTL_QUEUE_MAX || req.decimation > FC_CTL_DECIMATION_MAX || req.policy > FC_CTL_DISCONNECT) {
+        return FC_CTL_EINVAL;
+    }
+    c->queue = calloc(size, sizeof(FcCtlPoint));
+    if (c->queue == NULL) return FC_CTL_EBUSY;
+    c->queue_size = size;
+    c->decimation = req.decimation > 1 ? req.decimation : 1;
+    c->policy = req.policy;
+    c->watch = 1;
+    return FC_CTL_OK;
+}
+
+/**
+ * 订阅者入队一个点（已按抽取因子累计完成）
+ * 队列满时合并：新点替换队尾的点并累计丢失数；或断开连接
+ * @return 成功返回0，需要断开返回-1
+ */
+static int ctl_enqueue(CtlClient *c, FcCtlPoint *p) {
+    if (c->queue_count == c->queue_size) {
+        if (c->policy == FC_CTL_DISCONNECT) {
+            fprintf(stderr, "Dropping slow telemetry subscriber\n");
+            return -1;
+        }
+        FcCtlPoint *tail = &c->queue[(c->queue_head + c->queue_count - 1) % c->queue_size];
+        p->skipped = tail->skipped < 255 ? tail->skipped + 1 : 255;
+        *tail = *p;
+        return 0;
+    }
+    c->queue[(c->queue_head + c->queue_count) % c->queue_size] = *p;
+    c->queue_count++;
+    return 0;
+}
+
+/**
+ * 发送待发送的应答和订阅者队列中的点，直到套接字缓冲区满（不阻塞，未发完的部分在可写时继续）
+ * 应答总是先于推送的数据点发送
+ * @return 成功返回0，连接出错返回-1
+ */
+static int ctl_flush(CtlClient *c) {
+    while (c->reply) {
+        ssize_t n = send(c->fd, c->reply + c->reply_sent, c->reply_len - c->reply_sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        c->reply_sent += n;
+        if (c->reply_sent == c->reply_len) {
+            free(c->reply);
+            c->reply = NULL;
+        }
+    }
+    while (c->watch) {
+        if (c->out_sent == c->out_len) {
+            if (c->queue_count == 0) return 0;
+            FcCtlHeader hdr = { .magic = FC_CTL_MAGIC, .type = FC_CTL_WATCH, .status = FC_CTL_OK, .len = sizeof(FcCtlPoint) };
+            memcpy(c->out, &hdr, sizeof(hdr));
+            memcpy(c->out + sizeof(hdr), &c->queue[c->queue_head], sizeof(FcCtlPoint));
+            c->out_len = sizeof(c->out);
+            c->out_sent = 0;
+            c->queue_head = (c->queue_head + 1) % c->queue_size;
+            c->queue_count--;
+        }
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        c->out_sent += n;
+    }
+    return 0;
+}
+
+// 连接是否有待发送的数据
+static int ctl_pending(const CtlClient *c) {
+    return c->reply != NULL || c->out_sent < c->out_len || c->queue_count > 0;
+}
+
+// 把一个周期的数据点交给订阅者：按抽取因子取平均后入队并尝试发送
+static void ctl_publish(CtlClient *c, const FcCtlPoint *p) {
+    if (c->sum.n == 0) c->sum_time = p->time;
+    point_sum_add(&c->sum, p);
+    if (c->sum.n < c->decimation) return;
+
+    FcCtlPoint out;
+    point_sum_take(&c->sum, c->sum_time, &out);
+    if (ctl_enqueue(c, &out) != 0 || ctl_flush(c) != 0) {
+        ctl_close(c);
+    }
+}
+
+/**
+ * 放入一条应答并尝试立即发送，发不完的部分在连接可写时由 ctl_flush 继续
+ * @param msg 应答（含消息头，由 malloc 分配，所有权交给连接）
+ * @return 成功返回0，连接出错返回-1
+ */
+static int ctl_reply(CtlClient *c, unsigned char *msg, uint32_t len) {
+    c->reply = msg;
+    c->reply_len = len;
+    c->reply_sent = 0;
+    c->reply_since = monotonic_seconds();
+    return ctl_flush(c);
+}
+
+// 发送一条应答（不阻塞）
+static int ctl_send(CtlClient *c, int type, int status, const void *payload, uint32_t len) {
+    FcCtlHeader hdr = { .magic = FC_CTL_MAGIC, .type = type, .status = status, .len = len };
+    unsigned char *msg = malloc(sizeof(hdr) + len);
+    if (msg == NULL) return -1;
+    memcpy(msg, &hdr, sizeof(hdr));
+    if (len > 0) memcpy(msg + sizeof(hdr), payload, len);
+    return ctl_reply(c, msg, sizeof(hdr) + len);
+}
+
+// 查询历史记录并发送应答，数据直接编码到应答缓冲区中
+static int ctl_send_history(Telemetry *t, CtlClient *c, int type, uint32_t range, uint32_t resolution) {
+    unsigned char *msg = malloc(sizeof(FcCtlHeader) + FC_CTL_PAYLOAD_MAX);
+    if (msg == NULL) return ctl_send(c, type, FC_CTL_EBUSY, NULL, 0);
+    size_t len = telemetry_history(t, time(NULL), range, resolution, msg + sizeof(FcCtlHeader), FC_CTL_PAYLOAD_MAX);
+    FcCtlHeader hdr = { .magic = FC_CTL_MAGIC, .type = type, .status = FC_CTL_OK, .len = len };
+    memcpy(msg, &hdr, sizeof(hdr));
+    unsigned char *shrunk = realloc(msg, sizeof(hdr) + len);
+    return ctl_reply(c, shrunk ? shrunk : msg, sizeof(hdr) + len);
+}
+
+/**
+ * 处理一条请求
+ * @return 成功返回0，需要关闭连接返回-1
+ */
+static int ctl_handle(Telemetry *t, CtlClient *c, const FcCtlHeader *hdr, const unsigned char *payload) {
+    switch (hdr->type) {
+        case FC_CTL_HISTORY: {
+            FcCtlHistoryReq req;
+            if (hdr->len != sizeof(req)) return ctl_send(c, hdr->type, FC_CTL_EINVAL, NULL, 0);
+            memcpy(&req, payload, sizeof(req));
+            return ctl_send_history(t, c, hdr->type, req.range, req.resolution);
+        }
+        case FC_CTL_TRACE:
+            return ctl_send_history(t, c, hdr->type, TRACE_SIZE, 1);
+        case FC_CTL_WATCH: {
+            // 应答在订阅开始前发送，保证不与推送的数据交错
+            int status = ctl_subscribe(c, hdr, payload);
+            if (ctl_send(c, hdr->type, status, NULL, 0) != 0) return -1;
+            return status == FC_CTL_OK ? 0 : -1;
+        }
+        case FC_CTL_SET: {
+            FcCtlSetReq req;
+            if (hdr->len != sizeof(req)) return ctl_send(c, hdr->type, FC_CTL_EINVAL, NULL, 0);
+            memcpy(&req, payload, sizeof(req));
+            req.name[sizeof(req.name) - 1] = '\0';
+            int idx = tunable_find(req.name);
+            if (idx < 0) return ctl_send(c, hdr->type, FC_CTL_ENOENT, NULL, 0);
+            if (!(req.value >= tunables[idx].min && req.value <= tunables[idx].max)) {
+                return ctl_send(c, hdr->type, FC_CTL_EINVAL, NULL, 0);
+            }
+            ControlCommand cmd = { .type = CONTROL_SET, .tunable = idx, .value = req.value };
+            int status = control_queue_push(&control_queue, &cmd) == 0 ? FC_CTL_OK : FC_CTL_EBUSY;
+            return ctl_send(c, hdr->type, status, NULL, 0);
+        }
+        case FC_CTL_CALIBRATE: {
+            // 标定时风扇会停转，温度已高于目标温度时拒绝（控制线程执行时再检查一次）
+            if (t->trace_count > 0) {
+                const SampleRecord *last = &t->trace[(t->trace_pos + TRACE_SIZE - 1) % TRACE_SIZE];
+                if (last->temperature > last->setpoint) return ctl_send(c, hdr->type, FC_CTL_EHOT, NULL, 0);
+            }
+            ControlCommand cmd = { .type = CONTROL_CALIBRATE };
+            int status = control_queue_push(&control_queue, &cmd) == 0 ? FC_CTL_OK : FC_CTL_EBUSY;
+            return ctl_send(c, hdr->type, status, NULL, 0);
+        }
+        default:
+            return ctl_send(c, hdr->type, FC_CTL_ETYPE, NULL, 0);
+    }
+}
+
+/**
+ * 处理已收到的完整请求；上一条应答发完之前不处理下一条
+ */
+static void ctl_process(Telemetry *t, CtlClient *c) {
+    while (c->len >= sizeof(FcCtlHeader) && !c->watch && c->reply == NULL) {
+        FcCtlHeader hdr;
+        memcpy(&hdr, c->buf, sizeof(hdr));
+        if (hdr.magic != FC_CTL_MAGIC || hdr.len > sizeof(c->buf) - sizeof(hdr)) {
+            ctl_close(c);
+            return;
+        }
+        uint32_t total = sizeof(hdr) + hdr.len;
+        if (c->len < total) return;
+        if (ctl_handle(t, c, &hdr, c->buf + sizeof(hdr)) != 0) {
+            ctl_close(c);
+            return;
+        }
+        memmove(c->buf, c->buf + total, c->len - total);
+        c->len -= total;
+    }
+}
+
+// 读取连接上的数据，收到完整请求时处理
+static void ctl_read(Telemetry *t, CtlClient *c) {
+    ssize_t n = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, MSG_DONTWAIT);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        ctl_close(c);
+        return;
+    }
+    c->len += n;
+
+    // 订阅后连接只用于推送
+    if (c->watch) {
+        ctl_close(c);
+        return;
+    }
+    ctl_process(t, c);
+}
+
+static void ctl_accept(Telemetry *t, int listen_fd) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    for (int i = 0; i < CTL_CLIENTS_MAX; i++) {
+        if (t->client[i].fd < 0) {
+            t->client[i].fd = fd;
+            return;
+        }
+    }
+    close(fd);
+}
+
+static const char* ctl_socket_path = FC_CTL_SOCKET;    // 控制套接字路径（基准测试改为临时路径）
+
+/**
+ * 创建控制套接字（只允许root连接）
+ * @return 监听的文件描述符，失败返回-1
+ */
+static int ctl_listen(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", ctl_socket_path);
+    unlink(ctl_socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, CTL_CLIENTS_MAX) != 0) {
+        fprintf(stderr, "Cannot listen on control socket %s: %s\n", ctl_socket_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    chmod(ctl_socket_path, 0600);
+    return fd;
+}
+
+// 处理一条采样记录：写入跟踪缓冲区和历史记录，推送给订阅的连接，按间隔写温度日志
+static void telemetry_consume(Telemetry *t, const SampleRecord *rec) {
+    t->trace[t->trace_pos] = *rec;
+    t->trace_pos = (t->trace_pos + 1) % TRACE_SIZE;
+    if (t->trace_count < TRACE_SIZE) t->trace_count++;
+
+    FcCtlPoint p;
+    sample_point(rec, &p);
+    for (int i = 0; i < HISTORY_TIERS; i++) {
+        history_add(&t->tier[i], &p);
+    }
+    // 长期存储每秒一个点；重新加载配置后大小改变时重新打开（在写入方线程中进行，不与写入并发）
+    int size = __atomic_load_n(&tsdb_size, __ATOMIC_RELAXED);
+    if (size != tsdb_opened_size) {
+        tsdb_close();
+        tsdb_open(size);
+    }
+    if (tsdb && rec->wall != t->last_tsdb) {
+        FcTsdbPoint tp = {
+            .time = (uint32_t)rec->wall,
+            .temperature = rec->temperature,
+            .setpoint = rec->setpoint,
+            .pwm = rec->pwm,
+            .request = rec->request,
+            .rpm = rec->rpm,
+            .flags = (uint16_t)rec->flags,
+        };
+        tsdb_append(&tp);
+        t->last_tsdb = rec->wall;
+    }
+    for (int i = 0; i < CTL_CLIENTS_MAX; i++) {
+        CtlClient *c = &t->client[i];
+        if (c->fd >= 0 && c->watch) ctl_publish(c, &p);
+    }
+
+    int interval = __atomic_load_n(&log_interval, __ATOMIC_RELAXED);
+    if (difftime(rec->wall, t->last_log) >= interval) {
+        log_temperature(rec->temperature, interval);
+        t->last_log = rec->wall;
+    }
+    if (trace_requested) {
+        trace_requested = 0;
+        telemetry_dump_trace(t);
+    }
+}
+
+// 遥测线程：以较低优先级取出采样记录、处理控制套接字，文件和套接字操作不占用控制循环的时间
+static void* telemetry_thread_main(void *arg) {
+    Telemetry *t = arg;
+    // Linux下nice值按线程生效，只降低本线程的优先级
+    setpriority(PRIO_PROCESS, 0, TELEMETRY_NICE);
+    int listen_fd = ctl_listen();
+
+    while (1) {
+        struct pollfd pfd[CTL_CLIENTS_MAX + 1];
+        pfd[0].fd = listen_fd;
+        pfd[0].events = POLLIN;
+        double now = monotonic_seconds();
+        for (int i = 0; i < CTL_CLIENTS_MAX; i++) {
+            CtlClient *c = &t->client[i];
+            // 长时间不读取应答的连接关闭，释放连接槽和应答缓冲区
+            if (c->fd >= 0 && c->reply && now - c->reply_since > CTL_REPLY_TIMEOUT) ctl_close(c);
+            pfd[i + 1].fd = c->fd;
+            // 应答发完之前不再接收请求（请求缓冲区只能容纳一条）
+            pfd[i + 1].events = (c->reply ? 0 : POLLIN) | (c->fd >= 0 && ctl_pending(c) ? POLLOUT : 0);
+        }
+        if (poll(pfd, CTL_CLIENTS_MAX + 1, 200) > 0) {
+            if (pfd[0].revents & POLLIN) ctl_accept(t, listen_fd);
+            for (int i = 0; i < CTL_CLIENTS_MAX; i++) {
+                CtlClient *c = &t->client[i];
+                if (c->fd < 0 || c->fd != pfd[i + 1].fd) continue;
+                if (pfd[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) ctl_read(t, c);
+                if (c->fd >= 0 && (pfd[i + 1].revents & POLLOUT)) {
+                    if (ctl_flush(c) != 0) {
+                        ctl_close(c);
+                    } else {
+                        ctl_process(t, c);
+                    }
+                }
+            }
+        }
+
+        SampleRecord rec;
+        while (sample_ring_pop(&sample_ring, &rec)) {
+            telemetry_consume(t, &rec);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 启动遥测线程（屏蔽所有信号，信号只由控制线程处理）
+ * @return 成功返回0，失败返回-1（调用方改为在控制线程中直接处理记录）
+ */
+int telemetry_start(void) {
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t set, old;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    for (int i = 0; i < CTL_CLIENTS_MAX; i++) {
+        telemetry.client[i].fd = -1;
+    }
+    for (int i = 0; i < HISTORY_TIERS; i++) {
+        history_init(&telemetry.tier[i]);
+    }
+    int ret = pthread_create(&thread, &attr, telemetry_thread_main, &telemetry);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        fprintf(stderr, "Cannot start telemetry thread, logging from the control loop\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 共享内存状态页（见 fancontrol_status.h），映射失败时为NULL，不影响控制
+ */
+static FcStatus *status_page = NULL;
+
+/**
+ * 创建并映射状态页
+ * 守护进程重启时复用已有文件，已映射该文件的读取方不需要重新映射
+ */
+void status_page_open(void) {
+    int fd = open(FC_STATUS_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(FcStatus)) != 0) {
+        fprintf(stderr, "Cannot create status page %s: %s\n", FC_STATUS_FILE, strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void *p = mmap(NULL, sizeof(FcStatus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "Cannot map status page %s: %s\n", FC_STATUS_FILE, strerror(errno));
+        return;
+    }
+    status_page = p;
+
+    // 清空时保持 seq 为奇数，读取方不会读到半初始化的内容
+    uint32_t seq = status_page->seq | 1;
+    __atomic_store_n(&status_page->seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(&status_page->ticks, 0, sizeof(FcStatus) - offsetof(FcStatus, ticks));
+    status_page->version = FC_STATUS_VERSION;
+    status_page->size = sizeof(FcStatus);
+    status_page->daemon_pid = getpid();
+    status_page->magic = FC_STATUS_MAGIC;
+    __atomic_store_n(&status_page->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 更新状态页（每个控制周期一次）
+ * @param rec 本周期的采样记录
+ * @param fu 传感器融合状态
+ * @param speed_limit 当前PWM上限
+ * @param target_rpm 串级模式目标转速
+ */
+void status_page_update(const SampleRecord *rec, const SensorFusion *fu, int speed_limit, int target_rpm) {
+    FcStatus *st = status_page;
+    if (st == NULL) return;
+    const PIDController* pid = controller_pid(&temp_ctrl);
+
+    fc_status_write_begin(st);
+    st->ticks++;
+    st->mono = rec->time;
+    st->wall = rec->wall;
+    st->temperature = rec->temperature;
+    st->hottest = fu->hottest;
+    st->setpoint = rec->setpoint;
+    st->pwm = rec->pwm;
+    st->request = rec->request;
+    st->speed_limit = speed_limit;
+    st->rpm = rec->rpm;
+    st->target_rpm = cascade ? target_rpm : 0;
+    st->flags = rec->flags | (cascade ? FC_FLAG_CASCADE : 0);
+    strncpy(st->controller, temp_ctrl.ops->name, sizeof(st->controller) - 1);
+    st->output = rec->request * 100.0 / 255.0;
+    st->p_term = pid ? pid->p_term : 0;
+    st->i_term = pid ? pid->integral : 0;
+    st->d_term = pid ? pid->d_term : 0;
+    st->ff_term = pid ? pid->feedforward : 0;
+    st->sensor_count = fu->count < FC_STATUS_SENSORS ? fu->count : FC_STATUS_SENSORS;
+    for (int i = 0; i < st->sensor_count; i++) {
+        st->sensor[i].temperature = fu->sensor[i].value;
+        st->sensor[i].valid = fu->sensor[i].valid;
+    }
+    fc_status_write_end(st);
+}
+
+/**
+ * 判断文件是否存在方法
+ */
+static int file_exist(const char* name) {
+    struct stat buffer;
+    return stat(name ,&buffer);
+}
+
+/**
+ *  信号处理函数
+ */
+void handle_termination(int signum) {
+    // 设置风扇转速为 0
+    set_fanspeed(0 ,fan_pwm_file);
+    exit(EXIT_SUCCESS); // 优雅地退出程序
+}
+
+/**
+ * 重新加载配置信号（SIGHUP）
+ */
+static volatile sig_atomic_t reload_requested = 0;
+
+void handle_reload(int signum) {
+    (void)signum;
+    reload_requested = 1;
+}
+
+/**
+ * 导出跟踪缓冲区信号（SIGUSR1）
+ */
+void handle_trace(int signum) {
+    (void)signum;
+    trace_requested = 1;
+}
+
+/**
+ * 注册信号处理函数
+ */
+void register_signal_handlers( ) {
+    signal(SIGINT, handle_termination);
+    signal(SIGTERM, handle_termination);
+    signal(SIGHUP, handle_reload);
+    signal(SIGUSR1, handle_trace);
+}
+
+/**
+ * 应用配置：选择控制器，标定曲线覆盖相关参数，检查串级模式条件
+ */
+static void apply_config(void) {
+    // 直接输出PWM的控制器（曲线）不使用串级内环
+    controller_select(&temp_ctrl, controller);
+    if (temp_ctrl.ops->direct_pwm) {
+        cascade = 0;
+    }
+
+    if (fan_profile.valid) {
+        start_speed = fan_profile.sustain_duty;
+        if (max_rpm <= 0) max_rpm = fan_profile.max_rpm;
+    }
+
+    // 启动温度必须高于停止温度，否则没有滞环
+    if (zero_rpm && zero_rpm_start_temp <= zero_rpm_stop_temp) {
+        fprintf(stderr, "zero_rpm_start_temp must be above zero_rpm_stop_temp, using %.1f°C\n", zero_rpm_stop_temp + 1.0);
+        zero_rpm_start_temp = zero_rpm_stop_temp + 1.0;
+    }
+
+    // 串级模式需要转速反馈和最大转速
+    if (cascade) {
+        if (max_rpm <= 0 || get_fanspeed(fan_speed_file) < 0) {
+            fprintf(stderr, "Cascade mode needs max_rpm and a readable '%s', falling back to direct PWM control\n", fan_speed_file);
+            cascade = 0;
+        }
+        if (rpm_interval < 50) rpm_interval = 50;
+        if (rpm_interval > 1000) rpm_interval = 1000;
+    }
+}
+
+/**
+ * 主函数
+ */
+int main(int argc, char* argv[]) {
+    // 解析命令行选项
+    int opt;
+    while ((opt = getopt(argc, argv, "T:F:S:s:t:m:d:c:CA:D:v:")) != -1) {
         switch (opt) {
             case 'T':
                 snprintf(thermal_file, sizeof(thermal_file), "%s", optarg);
@@ -426,6 +4315,20 @@ int main(int argc, char* argv[]) {
             case 'd':
                 temp_div = atoi(optarg);
                 break;
+            case 'c':
+                snprintf(config_file, sizeof(config_file), "%s", optarg);
+                break;
+            case 'C':
+                calibrate_force = 1;
+                break;
+            case 'A':
+                if (!autotune_rule_valid(optarg)) {
+                    fprintf(stderr, "Error: unknown autotune rule '%s' (zn, tl, simc)\n", optarg);
+                    return 1;
+                }
+                autotune_force = 1;
+                snprintf(autotune_force_rule, sizeof(autotune_force_rule), "%s", optarg);
+                break;
             case 'D':
                 debug_mode = atoi(optarg);
                 break;
@@ -438,7 +4341,10 @@ int main(int argc, char* argv[]) {
                     "          -t temperature   # target temperature for PID control, default is %d°C\n"
                     "          -m speed         # fan maximum speed, default is %d\n"
                     "          -d div           # temperature divide, default is %d\n"
-                    "          -v               # verbose\n", argv[0], thermal_file, fan_pwm_file, fan_speed_file, start_speed, target_temp, max_speed, temp_div);
+                    "          -c file          # config file, default is '%s'\n"
+                    "          -C               # re-run the PWM/RPM calibration sweep\n"
+                    "          -A rule          # relay autotune PID gains (zn, tl, simc) and save to UCI\n"
+                    "          -v               # verbose\n", argv[0], thermal_file, fan_pwm_file, fan_speed_file, start_speed, target_temp, max_speed, temp_div, config_file);
                 exit(EXIT_FAILURE);
         }
     }
@@ -453,39 +4359,332 @@ int main(int argc, char* argv[]) {
     register_signal_handlers();
 
     // 解析配置文件
-    parse_config_file("/etc/config/fancontrol");
+    parse_config_file(config_file);
+
+    // 加载风扇标定曲线（首次运行时在控制循环中标定）
+    if (calibrate || calibrate_force) {
+        setup_fan_profile();
+    }
+    apply_config();
+
+    // 继电反馈自整定（完成后参数写入UCI并清除autotune标志）
+    if (autotune_force) {
+        snprintf(autotune_rule, sizeof(autotune_rule), "%s", autotune_force_rule);
+    }
+    if ((autotune || autotune_force) && autotune_run() == 0) {
+        controller_select(&temp_ctrl, controller);
+    }
 
     // 初始化日志文件（清空旧日志）
     mkdir("/tmp/log", 0755);
     FILE *log_file = fopen("/tmp/log/log.fancontrol_temp", "w");
     if (log_file) fclose(log_file);
 
+    // 状态页供其他程序无系统调用读取
+    status_page_open();
+    tsdb_open(tsdb_size);
+
+    // 温度日志和跟踪缓冲区由遥测线程处理
+    int telemetry_async = telemetry_start() == 0;
+
     // 主循环
     time_t last_log_time = 0;
     time_t last_pid_time = 0;
+    double last_pid_mono = 0;         // 上次控制器计算的单调时钟
     int fan_speed_set = start_speed;  // 初始风扇速度
+    int fan_speed_out = -1;           // 最近一次写入的PWM值
+    int last_request = -1;            // 上一次的控制器给定值（整形前）
+    int target_rpm = 0;               // 串级模式内环目标转速
+    StallMonitor stall = { 0 };
+    RPMLoop rpm_loop = { 0 };
+    OutputShaper shaper = { .output = -1, .target = -1 };
+    ZeroRPM zr = { 0 };
+    SensorHealth health = { 0 };
+    float temperature = 0.0;          // 最近一次有效的滤波后温度
+    int override = -1;                // 失效保护或超温时强制输出的PWM，-1表示不强制
+    int critical = 0;                 // 是否处于超温保护
+    int sched = -1;                   // 当前生效的静音时段，-1表示没有
+    time_t sched_next = 0;            // 下一次时段切换时间
+    time_t sched_wall = 0;            // 上一次计算时段时的系统时间
+    double sched_mono = 0;            // 上一次计算时段时的单调时钟
+    int speed_limit = max_speed;      // 当前PWM上限
+    int setpoint = target_temp;       // 当前目标温度
+    static SensorFusion fusion;
+    sensor_fusion_init(&fusion);
+    if (sensor_async) sensor_threads_start(&fusion);
+    ThermalModel model;
+    model_init(&model);
+    time_t last_adapt_time = 0;
+    CPUSampler cpu;
+    cpu_sampler_init(&cpu);
+    NetSampler net;
+    net_sampler_init(&net);
     
     while (1) {
-        // 读取当前温度
-        float temperature = get_temperature(thermal_file, temp_div);
+        // 收到SIGHUP时重新加载配置，控制器保留运行状态无扰切换
+        if (reload_requested) {
+            reload_requested = 0;
+            sensor_threads_stop();
+            parse_config_file(config_file);
+            apply_config();
+            sensor_fusion_init(&fusion);
+            if (sensor_async) sensor_threads_start(&fusion);
+            if (!ff_cpu_learn) cpu.gain = ff_cpu_gain;
+            net_sampler_close(&net);
+            net_sampler_init(&net);
+            sched = -1;
+            sched_next = 0;
+        }
+
+        // 执行控制套接字收到的命令（fancontrol-ctl）
+        ControlCommand cmd;
+        while (control_queue_pop(&control_queue, &cmd)) {
+            if (cmd.type == CONTROL_SET) {
+                tunable_apply(&tunables[cmd.tunable], cmd.value);
+            } else if (cmd.type == CONTROL_CALIBRATE && calibration.phase == CALIBRATE_IDLE) {
+                // 标定在后续控制周期中推进，完成后重新应用配置并复位控制器；
+                // 温度高于目标温度时拒绝，避免在已经偏热时停转风扇
+                if (temperature > setpoint) {
+                    fprintf(stderr, "Calibration refused: temperature %.1f°C above target %d°C\n", temperature, setpoint);
+                } else {
+                    calibrate_start(&calibration, monotonic_seconds());
+                }
+            }
+        }
 
-        // 记录温度日志（按配置间隔）
         time_t now;
         time(&now);
+
+        // 读取各传感器（分别预滤波）并融合；读数无效时沿用上一次有效温度，控制器暂停。
+        // 健康检查使用未经滤波的最高读数，滤波输出会掩盖读数停滞
+        float fused = sensor_fusion_read(&fusion, monotonic_seconds());
+        float raw = fused == -1.0 ? -1.0 : fusion.hottest;
+        int sensor_ok = sensor_health_update(&health, raw, monotonic_seconds());
+        if (sensor_ok) {
+            temperature = fused;
+        }
+
+        // 失效保护和超温保护在本次采样内生效，不等待PID周期，也不受控制器、时段上限和输出整形影响
+        int was_override = override >= 0;
+        override = -1;
+        if (health.failsafe) {
+            override = failsafe_speed;
+        }
+        if (sensor_ok) {
+            int hot = critical_temp > 0 && (fusion.hottest >= critical_temp || temperature >= critical_temp);
+            if (hot && !critical) {
+                fprintf(stderr, "Critical temperature %.1f°C reached, fan at maximum speed\n", fusion.hottest);
+            } else if (!hot && critical) {
+                fprintf(stderr, "Temperature back below critical (%.1f°C)\n", temperature);
+            }
+            critical = hot;
+        }
+        if (critical) {
+            override = max_speed;
+        }
+
+        // 标定期间由标定过程控制风扇；失效保护或超温保护生效时中止标定。
+        // 标定结束（成功或失败）的周期输出 max_speed，下一周期起恢复正常控制
+        int calibrating = 0;
+        if (calibration.phase != CALIBRATE_IDLE) {
+            int pwm = -1;
+            if (override >= 0) {
+                fprintf(stderr, "Calibration aborted: %s\n", critical ? "critical temperature" : "sensor fail-safe");
+                calibrate_finish(&calibration, 0);
+            } else {
+                pwm = calibrate_step(&calibration, temperature, monotonic_seconds());
+            }
+            if (pwm >= 0) {
+                override = pwm;
+                calibrating = 1;
+            } else {
+                if (override < 0) override = max_speed;
+                apply_config();
+                temp_ctrl.ops->reset(&temp_ctrl.st);
+            }
+        }
+        if (was_override && override < 0) {
+            last_pid_time = 0;
+        }
+
+        // 采样CPU利用率，供前馈和模型辨识使用
+        cpu_sampler_update(&cpu);
+        net_sampler_update(&net);
+
+        // 在线辨识热模型
+        if (sensor_ok && fan_speed_out >= 0) {
+            model_update(&model, temperature, fan_speed_out * 100.0 / 255.0, cpu.util);
+        }
+
+        // 静音时段：只在切换时间到达或系统时间跳变（如NTP校时）时重新计算
+        if (schedule_count > 0) {
+            double mono = monotonic_seconds();
+            if (now >= sched_next || fabs(difftime(now, sched_wall) - (mono - sched_mono)) > 60) {
+                int idx = schedule_evaluate(now, &sched_next);
+                sched_wall = now;
+                sched_mono = mono;
+                if (idx != sched) {
+                    const char* name = idx >= 0 && schedule[idx].controller[0] ? schedule[idx].controller : controller;
+                    if (idx >= 0) {
+                        fprintf(stderr, "Schedule entry %d active\n", idx + 1);
+                    } else {
+                        fprintf(stderr, "Schedule ended\n");
+                    }
+                    const ControllerOps* ops = controller_find(name);
+                    if (cascade && ops && ops->direct_pwm) {
+                        fprintf(stderr, "Controller '%s' can not be used in cascade mode\n", name);
+                    } else if (ops != temp_ctrl.ops) {
+                        controller_select(&temp_ctrl, name);
+                    }
+                    sched = idx;
+                    last_pid_time = 0;
+                }
+            }
+        } else {
+            sched = -1;
+        }
+
+        // 时段内限制PWM和偏移目标温度；温度超过 schedule_override_temp 时不受限制
+        speed_limit = max_speed;
+        setpoint = target_temp;
+        if (sched >= 0 && temperature < schedule_override_temp) {
+            // 上限低于启动速度时风扇转不起来，停转检测会反复施加启动脉冲，因此至少取启动速度；0表示停止
+            int cap = schedule[sched].max_speed;
+            if (cap > 0 && cap < start_speed) cap = start_speed;
+            if (cap >= 0 && cap < speed_limit) {
+                speed_limit = cap;
+            }
+            setpoint += schedule[sched].temp_offset;
+        }
+
+        // 负载和流量前馈：变化较大时立即更新输出，不等待下一个PID周期
+        feedforward_total = cpu_feedforward(&cpu) + net_feedforward(&net);
+        PIDController* pid = controller_pid(&temp_ctrl);
+        if (pid && pid->primed && sensor_ok && !zr.stopped && fabsf(feedforward_total - pid->feedforward) >= FF_UPDATE_STEP) {
+            float output = PID_UpdateFeedforward(pid, feedforward_total);
+            if (cascade) {
+                target_rpm = (int)(output / 100.0 * max_rpm + 0.5);
+                if (zero_rpm && target_rpm <= 0) target_rpm = 1;
+            } else {
+                fan_speed_set = output_to_pwm(output, speed_limit, start_speed);
+                if (zero_rpm && fan_speed_set < start_speed) fan_speed_set = start_speed;
+            }
+        }
+
+        // 写状态文件（按配置间隔，温度日志由遥测线程写）
         if (difftime(now, last_log_time) >= log_interval) {
-            log_temperature(temperature);
+            model_write_status(&model);
+            output_write_status(fan_speed_out, __atomic_load_n(&sample_ring.dropped, __ATOMIC_RELAXED));
+            sensor_fusion_write_status(&fusion, temperature);
             last_log_time = now;
         }
 
-        // PID计算（按配置间隔）
-        if (difftime(now, last_pid_time) >= pid_interval) {
-            fan_speed_set = calculate_speed_set(temperature, MAX_TEMP, target_temp, max_speed, start_speed);
-            set_fanspeed(fan_speed_set, fan_pwm_file);
+        // 根据辨识模型自适应调整PID参数（无扰切换）
+        if (model_adapt && model.valid && pid && pid->primed && difftime(now, last_adapt_time) >= MODEL_ADAPT_INTERVAL) {
+            float kp, ki, kd;
+            model_adapt_gains(&model, &kp, &ki, &kd);
+            PID_SetTunings(pid, kp, ki, kd);
+            last_adapt_time = now;
+        }
+
+        // 停转模式：停止期间不运行控制器（积分不累积），启动时复位控制器并施加启动脉冲
+        if (zero_rpm && sensor_ok) {
+            if (zero_rpm_update(&zr, temperature, monotonic_seconds())) {
+                if (zr.stopped) {
+                    fan_speed_set = 0;
+                    target_rpm = 0;
+                } else {
+                    temp_ctrl.ops->reset(&temp_ctrl.st);
+                    stall.kick_until = now + (kick_time > 0 ? kick_time : 1);
+                    last_pid_time = 0;
+                }
+            }
+        } else if (!zero_rpm) {
+            zr.stopped = 0;
+        }
+
+        // 控制器计算（按配置间隔）
+        if (sensor_ok && !zr.stopped && difftime(now, last_pid_time) >= pid_interval) {
+            // 积分和微分按实际间隔计算；提前计算（切换时段、保护结束）时间隔较短，
+            // 长时间暂停后最多按两个周期计算，避免积分突跳
+            double mono = monotonic_seconds();
+            float max_dt = pid_interval > 1 ? 2.0 * pid_interval : 2.0;
+            float pid_dt = last_pid_mono > 0 ? mono - last_pid_mono : (pid_interval > 1 ? pid_interval : 1);
+            if (pid_dt > max_dt) pid_dt = max_dt;
+            if (pid_dt < 0.1) pid_dt = 0.1;
+            last_pid_mono = mono;
+            if (cascade) {
+                // 串级模式：外环只更新目标转速，PWM由内环输出
+                target_rpm = calculate_rpm_set(&temp_ctrl, temperature, setpoint, pid_dt);
+                // 停转模式下运行期间不让内环停止风扇
+                if (zero_rpm && target_rpm <= 0) target_rpm = 1;
+            } else {
+                fan_speed_set = calculate_speed_set(&temp_ctrl, temperature, setpoint, speed_limit, start_speed, pid_dt);
+                // 停转模式下运行期间不低于启动速度，风扇只由停止温度关闭
+                if (zero_rpm && fan_speed_set < start_speed) fan_speed_set = start_speed;
+            }
+            if (ff_cpu_learn && pid) {
+                cpu_feedforward_learn(&cpu, pid);
+            }
             last_pid_time = now;
         }
 
-        // 休眠1秒，然后继续检查
-        sleep(1);
+        // 输出整形后写入PWM；读取转速反馈，检测停转并在需要时施加启动脉冲
+        // 串级模式下内环在1秒内以约 rpm_interval 为周期多次运行（四舍五入到整数次，至少1次，总时长保持1秒）
+        int inner_steps = cascade && rpm_interval > 0 ? (1000 + rpm_interval / 2) / rpm_interval : 1;
+        if (inner_steps < 1) inner_steps = 1;
+        int inner_ms = 1000 / inner_steps;
+        int rpm = -1;
+        int request = fan_speed_set;
+        for (int i = 0; i < inner_steps; i++) {
+            rpm = fan_speed_read();
+            if (cascade && stall.kick_until == 0 && override < 0) {
+                int rpm_limit = target_rpm;
+                if (sched >= 0 && temperature < schedule_override_temp && schedule[sched].max_rpm >= 0 && schedule[sched].max_rpm < rpm_limit) {
+                    rpm_limit = schedule[sched].max_rpm;
+                }
+                fan_speed_set = rpm_loop_step(&rpm_loop, rpm_limit, rpm, inner_ms / 1000.0);
+            }
+            request = fan_speed_set < speed_limit ? fan_speed_set : speed_limit;
+            int shaped;
+            if (override >= 0) {
+                // 强制输出不经过整形，整形状态同步到该值，恢复后从这里开始变化
+                shaped = override;
+                shaper.value = shaper.output = override;
+                shaper.change_time = monotonic_seconds();
+            } else {
+                shaped = output_shaper_apply(&shaper, request, monotonic_seconds());
+            }
+            // 标定需要原样输出扫描点，不做停转检测和启动脉冲
+            int speed_out = calibrating ? shaped : stall_monitor_update(&stall, shaped, rpm, time(NULL));
+            // 给定值变化了但输出不变时，本应发生的一次写入被省去
+            if (request != last_request && speed_out == fan_speed_out) pwm_elided++;
+            last_request = request;
+            set_fanspeed(speed_out, fan_pwm_file);
+            fan_speed_out = speed_out;
+
+            if (cascade) {
+                usleep(inner_ms * 1000);
+            } else {
+                // 休眠1秒，然后继续检查
+                sleep(1);
+            }
+        }
+
+        // 本周期的采样记录交给遥测线程（线程启动失败时直接处理）
+        SampleRecord rec = {
+            .time = monotonic_seconds(), .wall = now, .temperature = temperature, .setpoint = setpoint,
+            .request = request, .pwm = fan_speed_out, .rpm = rpm,
+            .flags = (health.failsafe ? FC_FLAG_FAILSAFE : 0) | (critical ? FC_FLAG_CRITICAL : 0) |
+                (zr.stopped ? FC_FLAG_STOPPED : 0) | (sched >= 0 ? FC_FLAG_SCHEDULE : 0) |
+                (stall.kick_until != 0 ? FC_FLAG_KICK : 0),
+        };
+        if (telemetry_async) {
+            sample_ring_push(&sample_ring, &rec);
+        } else {
+            telemetry_consume(&telemetry, &rec);
+        }
+        status_page_update(&rec, &fusion, speed_limit, target_rpm);
     }
 
     return 0;
@@ -0,0 +1,91 @@
+/**
+ * fancontrol 控制套接字协议
+ *
+ * 本地 Unix 流套接字，二进制定长结构，按本机字节序传输（只在本机使用）。
+ * 每条消息由 FcCtlHeader 和 len 字节的负载组成；应答的 type 与请求相同，status 为结果码。
+ * watch 请求应答后连接只用于推送：守护进程每 decimation 个控制周期推送一条 FC_CTL_WATCH 消息
+ * （负载为一个 FcCtlPoint，取这些周期的平均值）。每个订阅者有独立的有界队列，
+ * 读取太慢导致队列满时按 policy 合并（新点替换队尾的点，skipped 记录丢失的点数）或断开连接，
+ * 不会阻塞守护进程。订阅后再发送请求会被断开。
+ */
+#ifndef FANCONTROL_CTL_H
+#define FANCONTROL_CTL_H
+
+#include <stdint.h>
+
+#define FC_CTL_SOCKET "/var/run/fancontrol.sock"   // 控制套接字
+#define FC_CTL_MAGIC 0xFC01                         // 协议标识和版本
+#define FC_CTL_PAYLOAD_MAX (256 * 1024)             // 单条消息负载上限
+#define FC_CTL_NAME_MAX 24                          // 可调参数名最大长度
+
+/**
+ * 消息类型
+ */
+#define FC_CTL_HISTORY   1      // 历史记录，负载 FcCtlHistoryReq，应答为压缩的数据点（见 fancontrol_history.h）
+#define FC_CTL_TRACE     2      // 跟踪缓冲区（每秒一条），无负载，应答格式同 FC_CTL_HISTORY
+#define FC_CTL_WATCH     3      // 订阅实时数据，负载 FcCtlWatchReq（可省略，使用默认值）
+#define FC_CTL_SET       4      // 修改运行参数，负载 FcCtlSetReq
+#define FC_CTL_CALIBRATE 5      // 重新标定风扇，无负载
+
+/**
+ * 结果码
+ */
+#define FC_CTL_OK        0
+#define FC_CTL_EINVAL    1      // 请求格式错误或参数超出范围
+#define FC_CTL_ENOENT    2      // 未知的参数名
+#define FC_CTL_EBUSY     3      // 控制线程的命令队列已满
+#define FC_CTL_ETYPE     4      // 未知的消息类型
+#define FC_CTL_EHOT      5      // 温度高于目标温度，拒绝标定
+
+typedef struct {
+    uint16_t magic;
+    uint8_t type;
+    uint8_t status;         // 请求中为0
+    uint32_t len;           // 负载字节数
+} FcCtlHeader;
+
+typedef struct {
+    uint32_t range;         // 时间范围（秒）
+    uint32_t resolution;    // 时间分辨率（秒），0表示使用数据本身的分辨率
+} FcCtlHistoryReq;
+
+/**
+ * 订阅队列满时的处理方式
+ */
+#define FC_CTL_COALESCE  0      // 新点替换队尾的点
+#define FC_CTL_DISCONNECT 1     // 断开连接
+
+#define FC_CTL_QUEUE_DEFAULT 32     // 默认订阅队列长度
+#define FC_CTL_QUEUE_MAX 1024       // 订阅队列长度上限
+#define FC_CTL_DECIMATION_MAX 3600  // 抽取因子上限
+
+typedef struct {
+    uint16_t decimation;    // 每多少个控制周期推送一个点，0或1表示每个周期
+    uint16_t queue;         // 队列长度（点数），0表示默认
+    uint8_t policy;         // FC_CTL_COALESCE 或 FC_CTL_DISCONNECT
+    uint8_t reserved[3];
+} FcCtlWatchReq;
+
+typedef struct {
+    char name[FC_CTL_NAME_MAX];     // 参数名，与UCI选项名相同
+    float value;
+} FcCtlSetReq;
+
+/**
+ * 一个数据点（历史记录中为该时间段的平均值，标志按位或）
+ */
+typedef struct {
+    uint32_t time;          // 系统时间（该时间段的开始）
+    int16_t temperature;    // 温度（0.01°C）
+    int16_t setpoint;       // 目标温度（0.01°C）
+    uint16_t rpm;           // 风扇转速，FC_CTL_NO_RPM 表示无反馈
+    uint8_t pwm;            // 写入的PWM
+    uint8_t request;        // 控制器给定的PWM
+    uint8_t flags;          // FC_FLAG_* 标志（见 fancontrol_status.h）
+    uint8_t skipped;        // 订阅推送时，此前因队列满被合并掉的点数（最大255）
+    uint8_t reserved[2];
+} FcCtlPoint;
+
+#define FC_CTL_NO_RPM 0xffff
+
+#endif
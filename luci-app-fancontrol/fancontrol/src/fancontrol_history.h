@@ -0,0 +1,169 @@
+/**
+ * fancontrol 紧凑历史记录格式
+ *
+ * 数据点（FcCtlPoint）按顺序编码为字节流，每个点以一个掩码字节开头，
+ * 只写出与上一个点相比发生变化的字段：
+ *   时间间隔与上一个间隔不同时写出新间隔，等间隔的数据不占时间字节；
+ *   温度、目标温度（0.01°C）、PWM、给定PWM、转速写出与上一个点之差的 zig-zag varint；
+ *   标志变化时写出新值（1字节）。
+ * 编码状态从全0开始，第一个点的时间间隔即为其时间。每个流（一个块或一次应答）可独立解码。
+ * 守护进程用它保存长时间的历史记录，控制套接字的历史记录应答和LuCI页面（fancontrol.js 中的解码器）也使用同一格式。
+ */
+#ifndef FANCONTROL_HISTORY_H
+#define FANCONTROL_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fancontrol_ctl.h"
+
+/**
+ * 掩码位
+ */
+#define FC_HIST_DT       0x01   // 时间间隔变化
+#define FC_HIST_TEMP     0x02   // 温度变化
+#define FC_HIST_SETPOINT 0x04   // 目标温度变化
+#define FC_HIST_PWM      0x08   // PWM变化
+#define FC_HIST_REQUEST  0x10   // 给定PWM变化
+#define FC_HIST_RPM      0x20   // 转速变化
+#define FC_HIST_FLAGS    0x40   // 标志变化
+
+#define FC_HIST_POINT_MAX 20    // 单个点编码后的最大字节数
+
+/**
+ * 编码/解码状态（上一个点和上一个时间间隔）
+ */
+typedef struct {
+    FcCtlPoint prev;
+    int32_t prev_dt;
+} FcHistState;
+
+static inline uint32_t fc_hist_zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t fc_hist_unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline size_t fc_hist_put_varint(uint8_t *p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline int fc_hist_get_varint(const uint8_t *buf, size_t len, size_t *pos, uint32_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) return -1;
+        uint8_t b = buf[(*pos)++];
+        *v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return 0;
+    }
+    return -1;
+}
+
+/**
+ * 编码一个点
+ * @param st 编码状态（新的流从全0开始）
+ * @param p 数据点
+ * @param out 输出缓冲区，至少 FC_HIST_POINT_MAX 字节
+ * @return 写入的字节数
+ */
+static inline size_t fc_hist_encode(FcHistState *st, const FcCtlPoint *p, uint8_t *out) {
+    const FcCtlPoint *q = &st->prev;
+    int32_t dt = (int32_t)(p->time - q->time);
+    uint8_t mask = 0;
+    size_t n = 1;
+
+    if (dt != st->prev_dt) {
+        mask |= FC_HIST_DT;
+        n += fc_hist_put_varint(out + n, fc_hist_zigzag(dt));
+    }
+    if (p->temperature != q->temperature) {
+        mask |= FC_HIST_TEMP;
+        n += fc_hist_put_varint(out + n, fc_hist_zigzag(p->temperature - q->temperature));
+    }
+    if (p->setpoint != q->setpoint) {
+        mask |= FC_HIST_SETPOINT;
+        n += fc_hist_put_varint(out + n, fc_hist_zigzag(p->setpoint - q->setpoint));
+    }
+    if (p->pwm != q->pwm) {
+        mask |= FC_HIST_PWM;
+        n += fc_hist_put_varint(out + n, fc_hist_zigzag(p->pwm - q->pwm));
+    }
+    if (p->request != q->request) {
+        mask |= FC_HIST_REQUEST;
+        n += fc_hist_put_varint(out + n, fc_hist_zigzag(p->request - q->request));
+    }
+    if (p->rpm != q->rpm) {
+        mask |= FC_HIST_RPM;
+        n += fc_hist_put_varint(out + n, fc_hist_zigzag(p->rpm - q->rpm));
+    }
+    if (p->flags != q->flags) {
+        mask |= FC_HIST_FLAGS;
+        out[n++] = p->flags;
+    }
+    out[0] = mask;
+
+    st->prev = *p;
+    st->prev.skipped = 0;
+    st->prev_dt = dt;
+    return n;
+}
+
+/**
+ * 解码一个点
+ * @param st 解码状态（新的流从全0开始）
+ * @param buf 字节流
+ * @param len 字节流长度
+ * @param pos 读取位置，解码后前移
+ * @param p 输出的数据点
+ * @return 成功返回1，流结束返回0，格式错误返回-1
+ */
+static inline int fc_hist_decode(FcHistState *st, const uint8_t *buf, size_t len, size_t *pos, FcCtlPoint *p) {
+    if (*pos >= len) return 0;
+    uint8_t mask = buf[(*pos)++];
+    if (mask & 0x80) return -1;
+
+    FcCtlPoint *q = &st->prev;
+    uint32_t v;
+    if (mask & FC_HIST_DT) {
+        if (fc_hist_get_varint(buf, len, pos, &v) != 0) return -1;
+        st->prev_dt = fc_hist_unzigzag(v);
+    }
+    q->time += st->prev_dt;
+    if (mask & FC_HIST_TEMP) {
+        if (fc_hist_get_varint(buf, len, pos, &v) != 0) return -1;
+        q->temperature = (int16_t)(q->temperature + fc_hist_unzigzag(v));
+    }
+    if (mask & FC_HIST_SETPOINT) {
+        if (fc_hist_get_varint(buf, len, pos, &v) != 0) return -1;
+        q->setpoint = (int16_t)(q->setpoint + fc_hist_unzigzag(v));
+    }
+    if (mask & FC_HIST_PWM) {
+        if (fc_hist_get_varint(buf, len, pos, &v) != 0) return -1;
+        q->pwm = (uint8_t)(q->pwm + fc_hist_unzigzag(v));
+    }
+    if (mask & FC_HIST_REQUEST) {
+        if (fc_hist_get_varint(buf, len, pos, &v) != 0) return -1;
+        q->request = (uint8_t)(q->request + fc_hist_unzigzag(v));
+    }
+    if (mask & FC_HIST_RPM) {
+        if (fc_hist_get_varint(buf, len, pos, &v) != 0) return -1;
+        q->rpm = (uint16_t)(q->rpm + fc_hist_unzigzag(v));
+    }
+    if (mask & FC_HIST_FLAGS) {
+        if (*pos >= len) return -1;
+        q->flags = buf[(*pos)++];
+    }
+    *p = *q;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * fancontrol 共享内存状态页
+ *
+ * 守护进程每个控制周期把当前状态写入一个 mmap 的文件，用顺序锁（seqlock）保护：
+ * 写入前后各把 seq 加1，写入期间 seq 为奇数。读取方映射文件后直接拷贝，
+ * 拷贝前后 seq 相同且为偶数时数据一致，否则重试。读取不需要系统调用，也不会阻塞守护进程。
+ */
+#ifndef FANCONTROL_STATUS_H
+#define FANCONTROL_STATUS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FC_STATUS_FILE "/var/run/fancontrol.status"     // 状态页文件
+#define FC_STATUS_MAGIC 0x53434e46                      // "FNCS"
+#define FC_STATUS_VERSION 1
+#define FC_STATUS_SENSORS 8                             // 状态页中的传感器数量上限
+#define FC_STATUS_RETRIES 100                           // 读取时的最大重试次数
+
+/**
+ * 状态标志
+ */
+#define FC_FLAG_FAILSAFE 0x01   // 传感器失效保护中
+#define FC_FLAG_CRITICAL 0x02   // 超温保护中
+#define FC_FLAG_STOPPED  0x04   // 停转模式停止中
+#define FC_FLAG_SCHEDULE 0x08   // 静音时段生效中
+#define FC_FLAG_KICK     0x10   // 启动脉冲中
+#define FC_FLAG_CASCADE  0x20   // 串级转速控制
+
+typedef struct {
+    float temperature;      // 滤波后读数（已加偏移，°C）
+    int32_t valid;          // 本次是否参与融合
+} FcStatusSensor;
+
+typedef struct {
+    // 以下字段创建后不再变化
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;          // 结构体大小，读取方用于校验
+    int32_t daemon_pid;     // 守护进程PID
+
+    uint32_t seq;           // 顺序锁计数，奇数表示正在写入
+    uint32_t reserved;
+
+    // 以下字段受 seq 保护
+    uint64_t ticks;         // 控制周期计数
+    double mono;            // 更新时的单调时钟（秒，CLOCK_MONOTONIC）
+    int64_t wall;           // 更新时的系统时间
+    float temperature;      // 控制使用的温度（°C）
+    float hottest;          // 未滤波的最高读数（°C）
+    float setpoint;         // 当前目标温度（°C）
+    int32_t pwm;            // 写入的PWM
+    int32_t request;        // 控制器给定的PWM（整形前）
+    int32_t speed_limit;    // 当前PWM上限
+    int32_t rpm;            // 风扇转速，-1表示无反馈
+    int32_t target_rpm;     // 串级模式目标转速
+    uint32_t flags;         // FC_FLAG_* 标志
+    char controller[16];    // 控制器名称
+    float output;           // 控制器输出（%）
+    float p_term;           // PID比例项（%）
+    float i_term;           // PID积分项（%）
+    float d_term;           // PID微分项（%）
+    float ff_term;          // 前馈（%）
+    int32_t sensor_count;
+    FcStatusSensor sensor[FC_STATUS_SENSORS];
+} FcStatus;
+
+/**
+ * 写入方：开始/结束一次更新
+ */
+static inline void fc_status_write_begin(FcStatus *st) {
+    __atomic_store_n(&st->seq, st->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void fc_status_write_end(FcStatus *st) {
+    __atomic_store_n(&st->seq, st->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 只读映射状态页
+ * @param path 状态页文件，NULL表示默认路径
+ * @return 映射地址，文件不存在或格式不符返回NULL
+ */
+static inline const FcStatus* fc_status_map(const char *path) {
+    int fd = open(path ? path : FC_STATUS_FILE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(FcStatus)) {
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, sizeof(FcStatus), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    const FcStatus *st = p;
+    if (st->magic != FC_STATUS_MAGIC || st->version != FC_STATUS_VERSION || st->size != sizeof(FcStatus)) {
+        munmap(p, sizeof(FcStatus));
+        return NULL;
+    }
+    return st;
+}
+
+static inline void fc_status_unmap(const FcStatus *st) {
+    if (st) munmap((void*)st, sizeof(FcStatus));
+}
+
+/**
+ * 读取一份一致的状态快照
+ * @param st 映射的状态页
+ * @param out 输出
+ * @return 成功返回0，多次重试仍与写入冲突返回-1
+ */
+static inline int fc_status_read(const FcStatus *st, FcStatus *out) {
+    for (int i = 0; i < FC_STATUS_RETRIES; i++) {
+        uint32_t seq = __atomic_load_n(&st->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        memcpy(out, st, sizeof(FcStatus));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&st->seq, __ATOMIC_RELAXED) == seq) {
+            out->seq = seq;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#endif
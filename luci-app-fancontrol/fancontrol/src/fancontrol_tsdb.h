@@ -0,0 +1,344 @@
+/**
+ * fancontrol 长期时序存储（Gorilla 风格压缩）
+ *
+ * 守护进程每秒向 tmpfs 中的文件追加一个数据点。文件由一个文件头和固定大小的块组成，块按环形使用：
+ * 正在写入的块写满后封存，所有块用完时回收最早的块。块内按位编码，每块可独立解码：
+ *   时间：第一个点写32位原值，之后写二阶差分（本次间隔与上次间隔之差），
+ *         0写'0'，[-63,64]写'10'+7位，[-255,256]写'110'+9位，[-2047,2048]写'1110'+12位，其他写'1111'+32位；
+ *   数值：温度、目标温度（float）和PWM、给定PWM、转速、标志（整数）各自按32位与上一个值异或，
+ *         相同写'0'；有效位落在上一个窗口内写'10'+窗口内的位；否则写'11'+5位前导零数+5位（有效位数-1）+有效位。
+ *         每块第一个点与0异或。
+ * 块只追加：写入方先写数据位，再以 release 顺序更新 count，读取方只解码 count 个点；
+ * 回收块期间 seq 为奇数，读取方拷贝块前后比较 seq（与 fancontrol_status.h 的顺序锁相同）。
+ */
+#ifndef FANCONTROL_TSDB_H
+#define FANCONTROL_TSDB_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FC_TSDB_FILE "/tmp/fancontrol.tsdb"     // 存储文件（应位于 tmpfs）
+#define FC_TSDB_MAGIC 0x42445354                // "TSDB"
+#define FC_TSDB_VERSION 1
+#define FC_TSDB_BLOCK_SIZE 4096                 // 块大小，文件头也占一个块
+#define FC_TSDB_FIELDS 6                        // 每个点的数值个数
+#define FC_TSDB_POINT_BITS_MAX (36 + FC_TSDB_FIELDS * 44)  // 单个点编码后的最大位数
+#define FC_TSDB_RETRIES 100                     // 读取块时的最大重试次数
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t blocks;        // 块数量
+    uint32_t head;          // 正在写入的块
+    int32_t daemon_pid;
+} FcTsdbHeader;
+
+typedef struct {
+    uint32_t seq;           // 顺序锁计数，回收期间为奇数
+    uint32_t count;         // 已写入的点数
+    uint32_t bits;          // 已写入的位数
+    uint32_t first;         // 第一个点的时间
+    uint32_t last;          // 最后一个点的时间
+    uint32_t sealed;        // 已写满封存
+    uint8_t data[FC_TSDB_BLOCK_SIZE - 24];
+} FcTsdbBlock;
+
+/**
+ * 一个数据点
+ */
+typedef struct {
+    uint32_t time;          // 系统时间
+    float temperature;      // 控制使用的温度（°C）
+    float setpoint;         // 目标温度（°C）
+    int32_t pwm;            // 写入的PWM
+    int32_t request;        // 控制器给定的PWM
+    int32_t rpm;            // 风扇转速，-1表示无反馈
+    uint32_t flags;         // FC_FLAG_* 标志
+} FcTsdbPoint;
+
+/**
+ * 编码/解码状态（新的块从全0开始）
+ */
+typedef struct {
+    uint32_t prev;          // 上一个值
+    uint8_t lead;           // 上一个窗口的前导零数
+    uint8_t len;            // 上一个窗口的有效位数，0表示没有窗口
+} FcTsdbXor;
+
+typedef struct {
+    uint32_t count;         // 已编码的点数
+    uint32_t time;          // 上一个点的时间
+    int32_t delta;          // 上一个时间间隔
+    FcTsdbXor field[FC_TSDB_FIELDS];
+} FcTsdbState;
+
+static inline const FcTsdbBlock* fc_tsdb_block(const FcTsdbHeader *h, uint32_t i) {
+    return (const FcTsdbBlock*)((const uint8_t*)h + (size_t)FC_TSDB_BLOCK_SIZE * (i + 1));
+}
+
+static inline size_t fc_tsdb_file_size(uint32_t blocks) {
+    return (size_t)FC_TSDB_BLOCK_SIZE * (blocks + 1);
+}
+
+// 数据点与32位字之间的转换
+static inline void fc_tsdb_words(const FcTsdbPoint *p, uint32_t *w) {
+    memcpy(&w[0], &p->temperature, 4);
+    memcpy(&w[1], &p->setpoint, 4);
+    w[2] = (uint32_t)p->pwm;
+    w[3] = (uint32_t)p->request;
+    w[4] = (uint32_t)p->rpm;
+    w[5] = p->flags;
+}
+
+static inline void fc_tsdb_point(const uint32_t *w, FcTsdbPoint *p) {
+    memcpy(&p->temperature, &w[0], 4);
+    memcpy(&p->setpoint, &w[1], 4);
+    p->pwm = (int32_t)w[2];
+    p->request = (int32_t)w[3];
+    p->rpm = (int32_t)w[4];
+    p->flags = w[5];
+}
+
+// 按高位在前写入 n 位（缓冲区中未写入的位必须为0）
+static inline void fc_tsdb_put(uint8_t *data, uint32_t *bits, uint32_t v, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        if ((v >> i) & 1) data[*bits >> 3] |= 0x80 >> (*bits & 7);
+        (*bits)++;
+    }
+}
+
+static inline int fc_tsdb_get(const uint8_t *data, uint32_t limit, uint32_t *pos, int n, uint32_t *v) {
+    if (*pos + n > limit) return -1;
+    uint32_t r = 0;
+    for (int i = 0; i < n; i++, (*pos)++) {
+        r = (r << 1) | ((data[*pos >> 3] >> (7 - (*pos & 7))) & 1);
+    }
+    *v = r;
+    return 0;
+}
+
+static inline void fc_tsdb_put_xor(FcTsdbXor *x, uint32_t v, uint8_t *data, uint32_t *bits) {
+    uint32_t d = v ^ x->prev;
+    x->prev = v;
+    if (d == 0) {
+        fc_tsdb_put(data, bits, 0, 1);
+        return;
+    }
+    int lead = __builtin_clz(d);
+    int trail = __builtin_ctz(d);
+    if (x->len > 0 && lead >= x->lead && trail >= 32 - x->lead - x->len) {
+        fc_tsdb_put(data, bits, 0x2, 2);
+        fc_tsdb_put(data, bits, d >> (32 - x->lead - x->len), x->len);
+        return;
+    }
+    int len = 32 - lead - trail;
+    fc_tsdb_put(data, bits, 0x3, 2);
+    fc_tsdb_put(data, bits, lead, 5);
+    fc_tsdb_put(data, bits, len - 1, 5);
+    fc_tsdb_put(data, bits, d >> trail, len);
+    x->lead = lead;
+    x->len = len;
+}
+
+static inline int fc_tsdb_get_xor(FcTsdbXor *x, const uint8_t *data, uint32_t limit, uint32_t *pos) {
+    uint32_t v, d;
+    if (fc_tsdb_get(data, limit, pos, 1, &v) != 0) return -1;
+    if (v == 0) return 0;
+    if (fc_tsdb_get(data, limit, pos, 1, &v) != 0) return -1;
+    if (v == 1) {
+        uint32_t lead, len;
+        if (fc_tsdb_get(data, limit, pos, 5, &lead) != 0 || fc_tsdb_get(data, limit, pos, 5, &len) != 0) return -1;
+        len += 1;
+        if (lead + len > 32) return -1;
+        x->lead = lead;
+        x->len = len;
+    } else if (x->len == 0) {
+        return -1;
+    }
+    if (fc_tsdb_get(data, limit, pos, x->len, &d) != 0) return -1;
+    x->prev ^= d << (32 - x->lead - x->len);
+    return 0;
+}
+
+/**
+ * 编码一个点
+ * @param st 编码状态
+ * @param p 数据点
+ * @param data 块数据
+ * @param bits 已写入的位数，编码后前移（调用方保证剩余至少 FC_TSDB_POINT_BITS_MAX 位）
+ */
+static inline void fc_tsdb_encode(FcTsdbState *st, const FcTsdbPoint *p, uint8_t *data, uint32_t *bits) {
+    if (st->count == 0) {
+        fc_tsdb_put(data, bits, p->time, 32);
+    } else {
+        int32_t delta = (int32_t)(p->time - st->time);
+        int32_t dod = delta - st->delta;
+        if (dod == 0) {
+            fc_tsdb_put(data, bits, 0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            fc_tsdb_put(data, bits, 0x2, 2);
+            fc_tsdb_put(data, bits, dod + 63, 7);
+        } else if (dod >= -255 && dod <= 256) {
+            fc_tsdb_put(data, bits, 0x6, 3);
+            fc_tsdb_put(data, bits, dod + 255, 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            fc_tsdb_put(data, bits, 0xe, 4);
+            fc_tsdb_put(data, bits, dod + 2047, 12);
+        } else {
+            fc_tsdb_put(data, bits, 0xf, 4);
+            fc_tsdb_put(data, bits, (uint32_t)dod, 32);
+        }
+        st->delta = delta;
+    }
+    st->time = p->time;
+
+    uint32_t w[FC_TSDB_FIELDS];
+    fc_tsdb_words(p, w);
+    for (int i = 0; i < FC_TSDB_FIELDS; i++) {
+        fc_tsdb_put_xor(&st->field[i], w[i], data, bits);
+    }
+    st->count++;
+}
+
+/**
+ * 解码一个点
+ * @param st 解码状态
+ * @param data 块数据
+ * @param limit 数据位数
+ * @param pos 读取位置（位），解码后前移
+ * @param p 输出的数据点
+ * @return 成功返回0，格式错误返回-1
+ */
+static inline int fc_tsdb_decode(FcTsdbState *st, const uint8_t *data, uint32_t limit, uint32_t *pos, FcTsdbPoint *p) {
+    uint32_t v;
+    if (st->count == 0) {
+        if (fc_tsdb_get(data, limit, pos, 32, &st->time) != 0) return -1;
+    } else {
+        int32_t dod;
+        if (fc_tsdb_get(data, limit, pos, 1, &v) != 0) return -1;
+        if (v == 0) {
+            dod = 0;
+        } else {
+            int n = 1;
+            // 最多再读3个前缀位
+            while (n < 4) {
+                if (fc_tsdb_get(data, limit, pos, 1, &v) != 0) return -1;
+                if (v == 0) break;
+                n++;
+            }
+            static const int width[] = { 0, 7, 9, 12, 32 };
+            static const int bias[] = { 0, 63, 255, 2047, 0 };
+            if (fc_tsdb_get(data, limit, pos, width[n], &v) != 0) return -1;
+            dod = (int32_t)v - bias[n];
+        }
+        st->delta += dod;
+        st->time += st->delta;
+    }
+
+    uint32_t w[FC_TSDB_FIELDS];
+    for (int i = 0; i < FC_TSDB_FIELDS; i++) {
+        if (fc_tsdb_get_xor(&st->field[i], data, limit, pos) != 0) return -1;
+        w[i] = st->field[i].prev;
+    }
+    fc_tsdb_point(w, p);
+    p->time = st->time;
+    st->count++;
+    return 0;
+}
+
+/**
+ * 写入方：开始/结束回收一个块
+ */
+static inline void fc_tsdb_write_begin(FcTsdbBlock *b) {
+    __atomic_store_n(&b->seq, b->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void fc_tsdb_write_end(FcTsdbBlock *b) {
+    __atomic_store_n(&b->seq, b->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 只读映射存储文件
+ * @param path 存储文件，NULL表示默认路径
+ * @return 映射地址，文件不存在或格式不符返回NULL
+ */
+static inline const FcTsdbHeader* fc_tsdb_map(const char *path) {
+    int fd = open(path ? path : FC_TSDB_FILE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat sb;
+    FcTsdbHeader h;
+    if (fstat(fd, &sb) != 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+        h.magic != FC_TSDB_MAGIC || h.version != FC_TSDB_VERSION || h.block_size != FC_TSDB_BLOCK_SIZE ||
+        h.blocks == 0 || sb.st_size < (off_t)fc_tsdb_file_size(h.blocks)) {
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, fc_tsdb_file_size(h.blocks), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static inline void fc_tsdb_unmap(const FcTsdbHeader *h) {
+    if (h) munmap((void*)h, fc_tsdb_file_size(h->blocks));
+}
+
+/**
+ * 拷贝一个块的一致快照
+ * @return 成功返回0，多次重试仍与回收冲突返回-1
+ */
+static inline int fc_tsdb_read_block(const FcTsdbBlock *b, FcTsdbBlock *out) {
+    for (int i = 0; i < FC_TSDB_RETRIES; i++) {
+        uint32_t seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        uint32_t count = __atomic_load_n(&b->count, __ATOMIC_ACQUIRE);
+        memcpy(out, b, sizeof(FcTsdbBlock));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&b->seq, __ATOMIC_RELAXED) == seq) {
+            out->count = count;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 按时间顺序扫描 [from, to] 内的点，整块在范围外的块不解码
+ * @param h 映射的存储文件
+ * @param from 开始时间
+ * @param to 结束时间
+ * @param fn 每个点调用一次
+ * @param arg 传给 fn 的参数
+ * @return 扫描的点数，数据损坏返回-1
+ */
+static inline long fc_tsdb_scan(const FcTsdbHeader *h, uint32_t from, uint32_t to,
+                                void (*fn)(const FcTsdbPoint *p, void *arg), void *arg) {
+    uint32_t blocks = h->blocks;
+    uint32_t head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE) % blocks;
+    FcTsdbBlock b;
+    long n = 0;
+
+    // 从最早的块（正在写入的块的下一块）开始
+    for (uint32_t i = 1; i <= blocks; i++) {
+        if (fc_tsdb_read_block(fc_tsdb_block(h, (head + i) % blocks), &b) != 0) continue;
+        if (b.count == 0 || b.last < from || b.first > to) continue;
+
+        FcTsdbState st = { 0 };
+        FcTsdbPoint p;
+        uint32_t pos = 0;
+        for (uint32_t k = 0; k < b.count; k++) {
+            if (fc_tsdb_decode(&st, b.data, sizeof(b.data) * 8, &pos, &p) != 0) return -1;
+            if (p.time < from || p.time > to) continue;
+            fn(&p, arg);
+            n++;
+        }
+    }
+    return n;
+}
+
+#endif
@@ -79,6 +79,147 @@ async function readTemperatureLog() {
     }
 }
 
+/**
+ * 解码守护进程的紧凑历史记录（格式见 fancontrol/src/fancontrol_history.h）
+ * @param {Uint8Array} bytes - 编码后的数据
+ * @returns {Array} 数据点数组，格式错误时返回已解码的部分
+ */
+function decodeHistory(bytes) {
+    const points = [];
+    const prev = { time: 0, temperature: 0, setpoint: 0, pwm: 0, request: 0, rpm: 0, flags: 0 };
+    let dt = 0;
+    let pos = 0;
+
+    // varint 最多32位，用乘法避免位运算溢出
+    const varint = () => {
+        let v = 0;
+        for (let shift = 0; shift < 35; shift += 7) {
+            if (pos >= bytes.length) throw new Error('truncated varint');
+            const b = bytes[pos++];
+            v += (b & 0x7f) * Math.pow(2, shift);
+            if (!(b & 0x80)) return v;
+        }
+        throw new Error('varint too long');
+    };
+    // zig-zag 编码的差值
+    const delta = () => {
+        const v = varint();
+        return v % 2 ? -(v + 1) / 2 : v / 2;
+    };
+
+    try {
+        while (pos < bytes.length) {
+            const mask = bytes[pos++];
+            if (mask & 0x80) throw new Error('invalid mask');
+            if (mask & 0x01) dt = delta();
+            prev.time += dt;
+            if (mask & 0x02) prev.temperature += delta();
+            if (mask & 0x04) prev.setpoint += delta();
+            if (mask & 0x08) prev.pwm += delta();
+            if (mask & 0x10) prev.request += delta();
+            if (mask & 0x20) prev.rpm += delta();
+            if (mask & 0x40) {
+                if (pos >= bytes.length) throw new Error('truncated flags');
+                prev.flags = bytes[pos++];
+            }
+            points.push(Object.assign({}, prev));
+        }
+    } catch (err) {
+        console.warn("Malformed history data:", err);
+    }
+    return points;
+}
+
+/**
+ * 从守护进程读取历史温度
+ * @param {number} range - 时间范围（秒）
+ * @returns {Promise<Array|null>} 温度数据数组，守护进程不可用时返回null
+ */
+async function readHistory(range) {
+    try {
+        // 约每720个点覆盖整个范围，与图表宽度相当
+        const step = Math.max(Math.round(range / 720), 1);
+        const res = await fs.exec('/usr/bin/fancontrol-ctl', ['history', '-r', String(range), '-s', String(step), '-b']);
+        if (res.code !== 0) return null;
+
+        const raw = atob((res.stdout || '').trim());
+        const bytes = new Uint8Array(raw.length);
+        for (let i = 0; i < raw.length; i++) {
+            bytes[i] = raw.charCodeAt(i);
+        }
+        return decodeHistory(bytes).map(p => {
+            const date = new Date(p.time * 1000);
+            return {
+                time: range > 3600 ? date.toLocaleString('zh-CN', { hour12: false }) : date.toTimeString().slice(0, 8),
+                temperature: p.temperature / 100,
+                timestamp: p.time * 1000
+            };
+        });
+    } catch (err) {
+        return null;
+    }
+}
+
+/**
+ * 读取在线辨识的热模型参数
+ * @returns {Promise<Object|null>} 模型参数（key=value），读取失败返回null
+ */
+async function readThermalModel() {
+    try {
+        const raw = await fs.read('/tmp/log/fancontrol.model');
+        const model = {};
+        for (const line of (raw || '').trim().split('\n')) {
+            const [key, value] = line.split('=');
+            if (key && value !== undefined) model[key] = parseFloat(value);
+        }
+        return model.valid !== undefined ? model : null;
+    } catch (err) {
+        return null;
+    }
+}
+
+/**
+ * 读取PWM输出统计
+ * @returns {Promise<Object|null>} 统计值（key=value），读取失败返回null
+ */
+async function readOutputStats() {
+    try {
+        const raw = await fs.read('/tmp/log/fancontrol.output');
+        const stats = {};
+        for (const line of (raw || '').trim().split('\n')) {
+            const [key, value] = line.split('=');
+            if (key && value !== undefined) stats[key] = parseInt(value);
+        }
+        return stats.writes !== undefined ? stats : null;
+    } catch (err) {
+        return null;
+    }
+}
+
+/**
+ * 读取传感器融合结果
+ * @returns {Promise<Object|null>} 融合温度和各传感器读数，读取失败返回null
+ */
+async function readSensorStatus() {
+    try {
+        const raw = await fs.read('/tmp/log/fancontrol.sensors');
+        const status = { sensors: [] };
+        for (const line of (raw || '').trim().split('\n')) {
+            const [key, value] = line.split('=');
+            if (!key || value === undefined) continue;
+            if (key.startsWith('sensor')) {
+                const [path, temp, valid] = value.split(' ');
+                status.sensors.push({ path: path, temp: parseFloat(temp), valid: valid === '1' });
+            } else {
+                status[key] = key === 'fusion' ? value : parseFloat(value);
+            }
+        }
+        return status.temperature !== undefined ? status : null;
+    } catch (err) {
+        return null;
+    }
+}
+
 /**
  * 获取CSS变量值
  * @param {string} variable - CSS变量名
@@ -95,8 +236,9 @@ function getCSSVariable(variable, defaultValue) {
  * @param {HTMLElement} container - 图表容器
  * @param {Array} data - 温度数据
  * @param {number} targetTemp - 目标温度
+ * @param {number} [timeRange] - 时间范围（毫秒），默认1小时
  */
-function createTemperatureChart(container, data, targetTemp) {
+function createTemperatureChart(container, data, targetTemp, timeRange) {
     const canvas = container.querySelector('canvas');
     const ctx = canvas.getContext('2d');
     
@@ -127,20 +269,20 @@ function createTemperatureChart(container, data, targetTemp) {
     const minTemp = Math.min(...temperatures, targetTemp) - 2;
     const maxTemp = Math.max(...temperatures, targetTemp) + 2;
     
-    // 时间范围（最近1小时）
+    // 时间范围（默认最近1小时）
     const now = Date.now();
-    const timeRange = 60 * 60 * 1000; // 1小时
+    timeRange = timeRange || 60 * 60 * 1000;
     const minTime = now - timeRange;
     
-    // 过滤最近1小时的数据
+    // 过滤时间范围内的数据
     const recentData = data.filter(d => d.timestamp >= minTime);
     
     if (recentData.length === 0) {
-        // 没有最近1小时的数据时显示提示
+        // 时间范围内没有数据时显示提示
         ctx.fillStyle = textColor;
         ctx.font = '14px Arial';
         ctx.textAlign = 'center';
-        ctx.fillText(_('No temperature data in the last hour'), canvas.width / 2, canvas.height / 2);
+        ctx.fillText(_('No temperature data in the selected range'), canvas.width / 2, canvas.height / 2);
         return;
     }
     
@@ -245,7 +387,10 @@ function createTemperatureChart(container, data, targetTemp) {
     for (let i = 0; i <= xTimeSteps; i++) {
         const x = padding.left + (chartWidth / xTimeSteps) * i;
         const time = new Date(minTime + (timeRange / xTimeSteps) * i);
-        const timeStr = time.toLocaleTimeString('zh-CN', { hour12: false }).substring(0, 8);
+        // 超过1天时显示日期和时间
+        const timeStr = timeRange > 24 * 60 * 60 * 1000
+            ? (time.getMonth() + 1) + '-' + time.getDate() + ' ' + time.toTimeString().substring(0, 5)
+            : time.toLocaleTimeString('zh-CN', { hour12: false }).substring(0, 8);
         
         ctx.fillText(timeStr, x, padding.top + chartHeight + 20);
     }
@@ -379,6 +524,35 @@ return view.extend({
     	    o.description = _('Error reading fan speed file');
 	    }
  
+        // ==================== 控制器选择 ====================
+
+        // 控制器类型
+        o = s.option(form.ListValue, 'controller', _('Controller'), _('PID regulates towards the target temperature. Curve maps the temperature to PWM through the points below. On/off runs the fan at full speed above the target temperature plus the hysteresis and stops it below the target minus the hysteresis.'));
+        o.value('pid', _('PID'));
+        o.value('curve', _('Fan curve'));
+        o.value('bang', _('On/off'));
+        o.default = 'pid';
+
+        // 风扇曲线点
+        o = s.option(form.DynamicList, 'curve_point', _('Curve Points'), _('Points in the form temperature:PWM in ascending temperature order, e.g. 50:60. PWM is interpolated between points.'));
+        o.placeholder = '50:60';
+        o.depends('controller', 'curve');
+
+        // 升温滞环
+        o = s.option(form.Value, 'curve_hyst_rise', _('Rising Hysteresis'), _('Degrees the temperature must rise above the last applied point before PWM goes up (default: 0).'));
+        o.placeholder = '0';
+        o.depends('controller', 'curve');
+
+        // 降温滞环
+        o = s.option(form.Value, 'curve_hyst_fall', _('Falling Hysteresis'), _('Degrees the temperature must fall below the last applied point before PWM goes down (default: 2).'));
+        o.placeholder = '2';
+        o.depends('controller', 'curve');
+
+        // 开关控制滞环
+        o = s.option(form.Value, 'bang_hyst', _('On/off Hysteresis'), _('Degrees above and below the target temperature at which the fan switches on and off (default: 2).'));
+        o.placeholder = '2';
+        o.depends('controller', 'bang');
+
         // ==================== 风扇控制参数选项 ====================
         
         // 温度系数配置（用于温度值转换）
@@ -404,12 +578,16 @@ return view.extend({
         o.placeholder = '5.0';
 
         // PID积分增益系数
-        o = s.option(form.Value, 'Ki', _('PID Ki'), _('Integral gain for PID control. Helps eliminate steady-state error but may cause oscillation.'));
-        o.placeholder = '1.0';
+        o = s.option(form.Value, 'Ki', _('PID Ki'), _('Integral gain for PID control, in % output per °C of error per second. Helps eliminate steady-state error but may cause oscillation.'));
+        o.placeholder = '0.03';
 
         // PID微分增益系数
-        o = s.option(form.Value, 'Kd', _('PID Kd'), _('Derivative gain for PID control. Dampens the system response and reduces overshoot.'));
-        o.placeholder = '0.01';
+        o = s.option(form.Value, 'Kd', _('PID Kd'), _('Derivative gain for PID control, in % output per °C/s. Dampens the system response and reduces overshoot.'));
+        o.placeholder = '0.3';
+
+        // PID反算抗饱和增益
+        o = s.option(form.Value, 'Kb', _('PID Kb'), _('Back-calculation anti-windup gain, per second. Higher values make the controller recover faster after the output saturates; Kb multiplied by the PID interval is capped at 1, which removes the whole excess in one calculation.'));
+        o.placeholder = '1.0';
 
         // ==================== 系统参数选项 ====================
         
@@ -417,10 +595,337 @@ return view.extend({
         o = s.option(form.Value, 'log_interval', _('Log Interval'), _('Temperature logging interval in seconds (default: 10).'));
         o.placeholder = '10';
 
+        // 长期时序存储
+        o = s.option(form.Value, 'tsdb_size', _('Long-term Store Size'), _('Keep one compressed record per second in /tmp/fancontrol.tsdb, in KiB (about 6 bytes per record, 8192 KiB holds roughly 16 days). The oldest records are overwritten when full. Changing the size takes effect on reload and discards the stored records. 0 disables the store (default: 0).'));
+        o.placeholder = '0';
+        o.datatype = 'uinteger';
+
         // PID计算周期
         o = s.option(form.Value, 'pid_interval', _('PID Interval'), _('PID calculation interval in seconds (default: 5).'));
         o.placeholder = '30';
 
+        // ==================== 停转检测选项 ====================
+
+        // 停转判定时间
+        o = s.option(form.Value, 'stall_timeout', _('Stall Timeout'), _('Seconds the fan may report 0 RPM while PWM is above 0 before it is treated as stalled (default: 5).'));
+        o.placeholder = '5';
+
+        // 启动脉冲时间
+        o = s.option(form.Value, 'kick_time', _('Kick-start Time'), _('Seconds of full-speed kick-start applied after a stall (default: 2).'));
+        o.placeholder = '2';
+
+        // 停转告警次数
+        o = s.option(form.Value, 'stall_alarm', _('Stall Alarm'), _('Number of consecutive stalls before an alarm is written to the system log, 0 disables (default: 3).'));
+        o.placeholder = '3';
+
+        // ==================== 串级控制选项 ====================
+
+        // 启用串级控制
+        o = s.option(form.Flag, 'cascade', _('Cascade Control'), _('The temperature PID sets a target fan speed and a fast inner loop drives PWM to it using the fan speed feedback.'));
+        o.default = '0';
+
+        // 最大转速
+        o = s.option(form.Value, 'max_rpm', _('Max RPM'), _('Fan speed in RPM reached at maximum PWM. Required for cascade control.'));
+        o.placeholder = '0';
+        o.depends('cascade', '1');
+
+        // 内环比例增益
+        o = s.option(form.Value, 'rpm_Kp', _('Speed Loop Kp'), _('Proportional gain of the inner speed loop in PWM per RPM (default: 0.02).'));
+        o.placeholder = '0.02';
+        o.depends('cascade', '1');
+
+        // 内环积分增益
+        o = s.option(form.Value, 'rpm_Ki', _('Speed Loop Ki'), _('Integral gain of the inner speed loop in PWM per RPM second (default: 0.1).'));
+        o.placeholder = '0.1';
+        o.depends('cascade', '1');
+
+        // 内环周期
+        o = s.option(form.Value, 'rpm_interval', _('Speed Loop Interval'), _('Inner speed loop period in milliseconds, 50-1000 (default: 250).'));
+        o.placeholder = '250';
+        o.depends('cascade', '1');
+
+        // ==================== 风扇标定选项 ====================
+
+        // 启用风扇标定曲线
+        o = s.option(form.Flag, 'calibrate', _('Fan Calibration'), _('Sweep PWM against fan speed once and store the curve in /etc/fancontrol/. The curve replaces Initial Speed, linearizes fan output and skips PWM ranges that do not change the fan speed. The sweep runs inside the control loop, so over-temperature protection stays active. A failed sweep is not retried at startup; run fancontrol-ctl calibrate or delete the profile file to calibrate again.'));
+        o.default = '0';
+
+        // 标定稳定时间
+        o = s.option(form.Value, 'calibrate_settle', _('Calibration Settle Time'), _('Seconds to wait at each PWM step during calibration (default: 3).'));
+        o.placeholder = '3';
+        o.depends('calibrate', '1');
+
+        // ==================== 传感器预滤波选项 ====================
+
+        // 中值滤波窗口
+        o = s.option(form.Value, 'filter_median', _('Median Filter Window'), _('Number of samples for median outlier rejection, odd value 1-9 (default: 1, disabled).'));
+        o.placeholder = '1';
+
+        // 低通滤波类型
+        o = s.option(form.ListValue, 'filter_type', _('Low-pass Filter'), _('Low-pass filter applied to the temperature before the controller.'));
+        o.value('none', _('None'));
+        o.value('ema', _('Exponential moving average'));
+        o.value('biquad', _('Biquad (2nd order Butterworth)'));
+        o.default = 'none';
+
+        // EMA平滑系数
+        o = s.option(form.Value, 'filter_alpha', _('EMA Alpha'), _('Smoothing factor (0-1]. Smaller values smooth more but respond slower (default: 0.3).'));
+        o.placeholder = '0.3';
+        o.depends('filter_type', 'ema');
+
+        // biquad截止频率
+        o = s.option(form.Value, 'filter_cutoff', _('Filter Cutoff'), _('Cutoff frequency in Hz, must be below 0.5 as the temperature is sampled once per second (default: 0.05).'));
+        o.placeholder = '0.05';
+        o.depends('filter_type', 'biquad');
+
+        // 过采样次数
+        o = s.option(form.Value, 'oversample', _('Oversampling'), _('Number of sensor reads averaged per sample to gain resolution on 1°C sensors (default: 1).'));
+        o.placeholder = '1';
+
+        // ==================== PID自整定选项 ====================
+
+        // 启动时执行自整定
+        o = s.option(form.Flag, 'autotune', _('PID Autotune'), _('Run a relay feedback test around the target temperature on the next start and write the tuned PID gains back to this configuration.'));
+        o.default = '0';
+
+        // 整定规则
+        o = s.option(form.ListValue, 'autotune_rule', _('Tuning Rule'), _('Rule used to derive the PID gains from the measured oscillation.'));
+        o.value('zn', _('Ziegler-Nichols'));
+        o.value('tl', _('Tyreus-Luyben'));
+        o.value('simc', _('SIMC'));
+        o.default = 'tl';
+        o.depends('autotune', '1');
+
+        // 继电低输出
+        o = s.option(form.Value, 'autotune_low', _('Relay Low Output'), _('Fan output in percent while the temperature is below the target during the test (default: 0).'));
+        o.placeholder = '0';
+        o.depends('autotune', '1');
+
+        // 自整定最高温度
+        o = s.option(form.Value, 'autotune_max_temp', _('Autotune Temperature Limit'), _('The test is aborted and the fan runs at maximum speed above this temperature, 0 means target + 10°C.'));
+        o.placeholder = '0';
+        o.depends('autotune', '1');
+
+        // 自整定超时
+        o = s.option(form.Value, 'autotune_timeout', _('Autotune Timeout'), _('Maximum duration of the test in seconds (default: 3600).'));
+        o.placeholder = '3600';
+        o.depends('autotune', '1');
+
+        // ==================== 在线模型辨识选项 ====================
+
+        // 自适应调整PID参数
+        o = s.option(form.Flag, 'model_adapt', _('Adaptive Gains'), _('Adjust the PID gains from the online identified thermal model, within the range below.'));
+        o.default = '0';
+
+        // 显示当前辨识的模型
+        const model = await readThermalModel();
+        if (model && model.valid) {
+            o.description += '<br />' + _('Identified model:') + ` <b>τ=${model.tau.toFixed(0)}s K=${model.gain.toFixed(3)}°C/% θ=${model.dead_time}s</b>`;
+        } else if (model) {
+            o.description += '<br />' + _('Identifying thermal model (%d samples)').format(model.samples);
+        }
+
+        // 自适应参数范围
+        o = s.option(form.Value, 'model_adapt_range', _('Adaptive Gain Range'), _('Adapted Kp and Ki stay between the configured value divided and multiplied by this factor (default: 2.0).'));
+        o.placeholder = '2.0';
+        o.depends('model_adapt', '1');
+
+        // ==================== CPU负载前馈选项 ====================
+
+        // CPU负载前馈增益
+        o = s.option(form.Value, 'ff_cpu_gain', _('CPU Load Feed-forward'), _('Fan output in percent added at full CPU load, so the fan spins up before the temperature rises. 0 disables (default: 0).'));
+        o.placeholder = '0';
+
+        // 负载来源
+        o = s.option(form.ListValue, 'ff_cpu_source', _('CPU Load Source'), _('Use the overall CPU utilisation or the busiest core.'));
+        o.value('total', _('Overall utilisation'));
+        o.value('max_core', _('Busiest core'));
+        o.default = 'total';
+
+        // 在线学习前馈增益
+        o = s.option(form.Flag, 'ff_cpu_learn', _('Learn Feed-forward Gain'), _('Gradually move the load related part of the PID integral into the feed-forward gain, up to twice the configured value.'));
+        o.default = '0';
+
+        // 学习速率
+        o = s.option(form.Value, 'ff_cpu_learn_rate', _('Learning Rate'), _('Feed-forward gain learning rate (default: 0.01).'));
+        o.placeholder = '0.01';
+        o.depends('ff_cpu_learn', '1');
+
+        // ==================== 网络流量前馈选项 ====================
+
+        // 统计流量的网络设备
+        o = s.option(form.DynamicList, 'ff_net_iface', _('Traffic Feed-forward Devices'), _('Network devices as listed in /proc/net/dev (e.g. pppoe-wan, br-lan) whose traffic adds fan output.'));
+
+        // 增益表横坐标
+        o = s.option(form.ListValue, 'ff_net_metric', _('Traffic Metric'), _('Traffic measure used by the gain table.'));
+        o.value('mbps', _('Throughput (Mbit/s)'));
+        o.value('kpps', _('Packet rate (kpps)'));
+        o.default = 'mbps';
+
+        // 增益表
+        o = s.option(form.DynamicList, 'ff_net_point', _('Traffic Gain Table'), _('Points in the form rate:output, e.g. 500:20 adds 20% fan output at 500 Mbit/s. Values between points are interpolated.'));
+        o.placeholder = '500:20';
+
+        // 射频忙碌时间文件
+        o = s.option(form.DynamicList, 'ff_airtime_file', _('Radio Busy Time Files'), _('Files holding a cumulative channel busy time in microseconds, one per radio.'));
+
+        // 射频前馈增益
+        o = s.option(form.Value, 'ff_airtime_gain', _('Radio Airtime Feed-forward'), _('Fan output in percent added when the busiest radio is 100% busy (default: 0).'));
+        o.placeholder = '0';
+
+        // ==================== PWM输出整形选项 ====================
+
+        // 升速变化率
+        o = s.option(form.Value, 'pwm_slew_up', _('Ramp-up Rate'), _('Maximum PWM increase per second, 0 means unlimited.'));
+        o.placeholder = '0';
+
+        // 降速变化率
+        o = s.option(form.Value, 'pwm_slew_down', _('Ramp-down Rate'), _('Maximum PWM decrease per second, 0 means unlimited.'));
+        o.placeholder = '0';
+
+        // 输出死区
+        o = s.option(form.Value, 'pwm_deadband', _('PWM Deadband'), _('The output is not changed while the requested PWM differs from it by less than this value (stop and maximum speed are always applied).'));
+        o.placeholder = '0';
+
+        // 显示写入统计
+        const stats = await readOutputStats();
+        if (stats) {
+            o.description += '<br />' + _('PWM writes: %d, setpoint changes not written: %d, setpoint changes altered by shaping: %d').format(stats.writes, stats.elided, stats.shaped);
+            if (stats.dropped > 0) {
+                o.description += '<br />' + _('Telemetry samples dropped (logging fell behind): %d').format(stats.dropped);
+            }
+        }
+
+        // 最短保持时间
+        o = s.option(form.Value, 'pwm_dwell', _('Minimum Dwell Time'), _('Seconds the output is held after each change.'));
+        o.placeholder = '0';
+
+        // ==================== 停转模式选项 ====================
+
+        // 启用停转模式
+        o = s.option(form.Flag, 'zero_rpm', _('Zero RPM Mode'), _('Stop the fan completely below the stop temperature and restart it with a kick pulse above the start temperature. While running the fan never drops below the start speed.'));
+        o.default = '0';
+
+        // 停止温度
+        o = s.option(form.Value, 'zero_rpm_stop_temp', _('Stop Temperature'), _('The fan stops below this temperature (default: 40).'));
+        o.placeholder = '40';
+        o.depends('zero_rpm', '1');
+
+        // 启动温度
+        o = s.option(form.Value, 'zero_rpm_start_temp', _('Start Temperature'), _('The fan starts above this temperature, must be higher than the stop temperature. It always starts at the target temperature (default: 48).'));
+        o.placeholder = '48';
+        o.depends('zero_rpm', '1');
+
+        // 最短停止时间
+        o = s.option(form.Value, 'zero_rpm_min_off', _('Minimum Off Time'), _('Seconds the fan stays off after stopping (default: 60).'));
+        o.placeholder = '60';
+        o.depends('zero_rpm', '1');
+
+        // 最短运行时间
+        o = s.option(form.Value, 'zero_rpm_min_on', _('Minimum On Time'), _('Seconds the fan keeps running after starting (default: 120).'));
+        o.placeholder = '120';
+        o.depends('zero_rpm', '1');
+
+        // 时段上限失效温度
+        o = s.option(form.Value, 'schedule_override_temp', _('Quiet Hours Override Temperature'), _('Above this temperature the quiet hours caps and setpoint offsets are ignored (default: 70).'));
+        o.placeholder = '70';
+
+        // ==================== 静音时段 ====================
+        const ss = m.section(form.GridSection, 'schedule', _('Quiet Hours'), _('Time ranges that cap the fan speed, shift the target temperature or switch the controller. The first matching entry applies.'));
+        ss.anonymous = true;
+        ss.addremove = true;
+        ss.sortable = true;
+
+        o = ss.option(form.Flag, 'enabled', _('Enable'));
+        o.default = '1';
+        o.rmempty = false;
+
+        o = ss.option(form.Value, 'days', _('Days'), _('e.g. mon-fri or sat sun, empty means every day'));
+        o.placeholder = 'mon-fri';
+
+        o = ss.option(form.Value, 'start', _('Start Time'));
+        o.placeholder = '22:00';
+
+        o = ss.option(form.Value, 'end', _('End Time'), _('An end time not after the start time spans midnight'));
+        o.placeholder = '07:00';
+
+        o = ss.option(form.Value, 'max_speed', _('PWM Limit'), _('Values below the start speed are raised to it; 0 stops the fan'));
+        o.datatype = 'range(0,255)';
+
+        o = ss.option(form.Value, 'max_rpm', _('RPM Limit'), _('Cascade mode only'));
+        o.datatype = 'uinteger';
+
+        o = ss.option(form.Value, 'temp_offset', _('Temperature Offset'));
+        o.datatype = 'integer';
+        o.placeholder = '0';
+
+        o = ss.option(form.ListValue, 'controller', _('Controller'));
+        o.value('', _('Unchanged'));
+        o.value('pid', _('PID'));
+        o.value('curve', _('Fan curve'));
+        o.value('bang', _('On/off'));
+
+        // ==================== 失效保护选项 ====================
+
+        // 读取失败次数
+        o = s.option(form.Value, 'failsafe_reads', _('Fail-safe Read Failures'), _('Consecutive failed or invalid temperature reads before the fan goes to the fail-safe speed (default: 3).'));
+        o.placeholder = '3';
+        o.datatype = 'uinteger';
+
+        // 失效保护速度
+        o = s.option(form.Value, 'failsafe_speed', _('Fail-safe Speed'), _('PWM value used while the temperature sensor is failing (default: 255).'));
+        o.placeholder = '255';
+        o.datatype = 'range(0,255)';
+
+        // 数值不变超时
+        o = s.option(form.Value, 'stale_timeout', _('Stale Sensor Timeout'), _('Treat the sensor as failed when its value does not change for this many seconds, 0 disables the check.'));
+        o.placeholder = '0';
+        o.datatype = 'uinteger';
+
+        // 超温保护温度
+        o = s.option(form.Value, 'critical_temp', _('Critical Temperature'), _('At this temperature the fan runs at maximum speed immediately, bypassing the controller, quiet hours and ramp limits. 0 disables it (default: 85).'));
+        o.placeholder = '85';
+        o.datatype = 'uinteger';
+
+        // ==================== 多传感器融合选项 ====================
+
+        // 传感器列表
+        o = s.option(form.DynamicList, 'sensor', _('Sensors'), _('Temperature sensors to fuse, in the form path[:offset[:weight]]. Replaces the thermal file when set.'));
+        o.placeholder = '/sys/devices/virtual/thermal/thermal_zone1/temp:0:1';
+
+        // 显示各传感器读数
+        const sensors = await readSensorStatus();
+        if (sensors && sensors.sensors.length > 1) {
+            const parts = sensors.sensors.map(x => `${x.path.split('/').slice(-2).join('/')} ${x.valid ? x.temp.toFixed(1) + '°C' : _('stale')}`);
+            o.description += '<br />' + _('Fused:') + ` <b>${sensors.temperature.toFixed(1)}°C</b>` +
+                (sensors.variance !== undefined ? ` (σ²=${sensors.variance.toFixed(3)})` : '') + ' — ' + parts.join(', ');
+        }
+
+        // 融合方式
+        o = s.option(form.ListValue, 'sensor_fusion', _('Sensor Fusion'), _('How the sensor readings are combined into one temperature. Sensors that fail or stop changing are left out.'));
+        o.value('max', _('Hottest sensor'));
+        o.value('mean', _('Weighted mean'));
+        o.value('kalman', _('Kalman filter'));
+        o.default = 'max';
+
+        // 卡尔曼参数
+        o = s.option(form.Value, 'fusion_q', _('Kalman Process Noise'), _('°C² per second, larger values follow temperature changes faster (default: 0.05).'));
+        o.placeholder = '0.05';
+        o.depends('sensor_fusion', 'kalman');
+
+        o = s.option(form.Value, 'fusion_r', _('Kalman Measurement Noise'), _('°C², divided by each sensor weight (default: 1.0).'));
+        o.placeholder = '1.0';
+        o.depends('sensor_fusion', 'kalman');
+
+        // 异步读取传感器
+        o = s.option(form.Flag, 'sensor_async', _('Asynchronous Sensor Reads'), _('Read each sensor and the fan speed in their own threads so slow I2C devices do not delay the control loop. The controller uses the latest cached values.'));
+        o.default = '0';
+
+        // io_uring 批量读取
+        o = s.option(form.Flag, 'io_uring', _('Batch Reads with io_uring'), _('Submit all sensor reads of a cycle with a single system call. Falls back to pread when the kernel does not support io_uring.'));
+        o.default = '0';
+        o.depends('sensor_async', '0');
+
         // 渲染表单
         const renderedForm = await m.render();
         
@@ -439,10 +944,17 @@ return view.extend({
             E('h3', {}, _('Trend'))
         ]);
         
+            // 时间范围选择（1小时以上的数据由守护进程的历史记录提供）
+            const rangeSelect = E('select', { 'class': 'cbi-input-select', 'style': 'width: auto; margin-left: 10px;' }, [
+                E('option', { 'value': '3600' }, _('Last 1 hour')),
+                E('option', { 'value': '86400' }, _('Last 24 hours')),
+                E('option', { 'value': '604800' }, _('Last 7 days'))
+            ]);
+
             // 图表标题 - 使用与参数文字相同的颜色
             const title = E('div', {
                 'style': 'font-weight: bold; margin-bottom: 10px; text-align: center; color: var(--text-color, #666);'
-            }, _('Temperature Trend (Last 1 Hour)'));
+            }, [ _('Temperature Trend'), rangeSelect ]);
         
         // Canvas图表 - 自适应宽度
         const canvas = E('canvas', {
@@ -466,6 +978,8 @@ return view.extend({
         
         // 动态调整canvas分辨率以适应容器宽度
         let chartData = null;
+        let chartPoints = [];   // 图表数据（按时间升序）
+        let chartRange = 3600;  // 图表时间范围（秒）
         const resizeCanvas = () => {
             const containerWidth = chartContainer.offsetWidth - 20; // 减去padding
             if (containerWidth > 0) {
@@ -474,9 +988,7 @@ return view.extend({
                 
                 // 重新绘制图表
                 const targetTemp = parseInt(uci.get('fancontrol', '@settings[0]', 'target_temp')) || 55;
-                readTemperatureLog().then(data => {
-                    chartData = createTemperatureChart(chartContainer, data, targetTemp);
-                });
+                chartData = createTemperatureChart(chartContainer, chartPoints, targetTemp, chartRange * 1000);
             }
         };
         
@@ -487,38 +999,54 @@ return view.extend({
         // 获取目标温度
         const targetTemp = parseInt(uci.get('fancontrol', '@settings[0]', 'target_temp')) || 55;
         
-        // 初始绘制图表
-        readTemperatureLog().then(data => {
-            console.log("Temperature data loaded:", data.length, "points");
-            chartData = createTemperatureChart(chartContainer, data, targetTemp);
+        // 读取并绘制当前时间范围的数据：优先使用守护进程的历史记录，不可用时1小时范围退回温度日志
+        const loadChart = () => {
+            const range = chartRange;
+            return readHistory(range).then(data => {
+                if (data === null && range === 3600) return readTemperatureLog();
+                return data || [];
+            }).then(data => {
+                if (range !== chartRange) return; // 读取期间切换了范围
+                console.log("Temperature data loaded:", data.length, "points");
+                chartPoints = data.sort((a, b) => a.timestamp - b.timestamp);
+                chartData = createTemperatureChart(chartContainer, chartPoints, targetTemp, chartRange * 1000);
+            });
+        };
+
+        rangeSelect.addEventListener('change', () => {
+            chartRange = parseInt(rangeSelect.value) || 3600;
+            loadChart();
+        });
+
+        // 添加鼠标悬停交互功能
+        canvas.addEventListener('mousemove', (e) => {
+            if (!chartData || !chartData.recentData || chartData.recentData.length === 0) return;
             
-            // 添加鼠标悬停交互功能
-            canvas.addEventListener('mousemove', (e) => {
-                if (!chartData || !chartData.recentData || chartData.recentData.length === 0) return;
-                
-                const rect = canvas.getBoundingClientRect();
-                const mouseX = e.clientX - rect.left;
-                const mouseY = e.clientY - rect.top;
-
-                const hoverRadius = 6;
-                let found = false;
-
-                for (const point of chartData.recentData) {
-                    const x = chartData.padding.left + ((point.timestamp - chartData.minTime) / chartData.timeRange) * chartData.chartWidth;
-                    const y = chartData.padding.top + chartData.chartHeight - ((point.temperature - chartData.minTemp) / (chartData.maxTemp - chartData.minTemp)) * chartData.chartHeight;
-
-                    if (Math.abs(mouseX - x) < hoverRadius && Math.abs(mouseY - y) < hoverRadius) {
-                        showTooltip(e.pageX, e.pageY, `${point.time}<br>${point.temperature.toFixed(1)}°C`);
-                        found = true;
-                        break;
-                    }
+            const rect = canvas.getBoundingClientRect();
+            const mouseX = e.clientX - rect.left;
+            const mouseY = e.clientY - rect.top;
+
+            const hoverRadius = 6;
+            let found = false;
+
+            for (const point of chartData.recentData) {
+                const x = chartData.padding.left + ((point.timestamp - chartData.minTime) / chartData.timeRange) * chartData.chartWidth;
+                const y = chartData.padding.top + chartData.chartHeight - ((point.temperature - chartData.minTemp) / (chartData.maxTemp - chartData.minTemp)) * chartData.chartHeight;
+
+                if (Math.abs(mouseX - x) < hoverRadius && Math.abs(mouseY - y) < hoverRadius) {
+                    showTooltip(e.pageX, e.pageY, `${point.time}<br>${point.temperature.toFixed(1)}°C`);
+                    found = true;
+                    break;
                 }
+            }
 
-                if (!found) hideTooltip();
-            });
+            if (!found) hideTooltip();
+        });
+
+        canvas.addEventListener('mouseleave', hideTooltip);
 
-            canvas.addEventListener('mouseleave', hideTooltip);
-        }).catch(err => {
+        // 初始绘制图表
+        loadChart().catch(err => {
             console.error("Error loading temperature data:", err);
             // 显示错误信息
             const ctx = canvas.getContext('2d');
@@ -529,22 +1057,75 @@ return view.extend({
             ctx.fillText(_('Error loading temperature data'), canvas.width / 2, canvas.height / 2);
         });
         
-        // 自动刷新机制
+        // 自动刷新机制：轮询温度日志（实时推送不可用时使用）
         const logInterval = parseInt(uci.get('fancontrol', '@settings[0]', 'log_interval')) || 10;
         const refreshInterval = Math.max(logInterval * 1000, 5000); // 最小5秒刷新间隔
         
-        let refreshTimer = setInterval(() => {
-            readTemperatureLog().then(data => {
-                console.log("Temperature data loaded:", data.length, "points");
-                createTemperatureChart(chartContainer, data, targetTemp);
-            });
-        }, refreshInterval);
+        let refreshTimer = null;
+        const startPolling = () => {
+            if (refreshTimer) return;
+            refreshTimer = setInterval(() => {
+                if (chartRange === 3600) loadChart();
+            }, refreshInterval);
+        };
+
+        // 1小时以上的范围按分钟刷新
+        const historyTimer = setInterval(() => {
+            if (chartRange > 3600) loadChart();
+        }, 60 * 1000);
+
+        // 实时推送：守护进程每个控制周期通过Server-Sent Events推送一条数据，
+        // 只在页面打开期间连接；从未连接成功（旧版本或没有权限）时退回轮询，连接过的断开后由浏览器自动重连
+        let events = null;
+        if (window.EventSource) {
+            let opened = false;
+            events = new EventSource('/cgi-bin/fancontrol-events');
+            events.onopen = () => {
+                opened = true;
+            };
+            events.onmessage = (e) => {
+                let sample;
+                try {
+                    sample = JSON.parse(e.data);
+                } catch (err) {
+                    return;
+                }
+                // 实时数据只用于1小时范围
+                if (chartRange !== 3600) return;
+                const timestamp = sample.time * 1000;
+                chartPoints.push({
+                    time: new Date(timestamp).toTimeString().slice(0, 8), // HH:MM:SS
+                    temperature: sample.temperature,
+                    timestamp: timestamp
+                });
+
+                // 只保留最近1小时的数据
+                const minTime = Date.now() - 60 * 60 * 1000;
+                while (chartPoints.length > 0 && chartPoints[0].timestamp < minTime) {
+                    chartPoints.shift();
+                }
+                chartData = createTemperatureChart(chartContainer, chartPoints, targetTemp, chartRange * 1000);
+            };
+            events.onerror = () => {
+                if (!opened) {
+                    events.close();
+                    events = null;
+                    startPolling();
+                }
+            };
+        } else {
+            startPolling();
+        }
         
-        // 清理定时器（当页面卸载时）
+        // 清理定时器和推送连接（当页面卸载时）
         window.addEventListener('beforeunload', () => {
             if (refreshTimer) {
                 clearInterval(refreshTimer);
             }
+            clearInterval(historyTimer);
+            if (events) {
+                events.close();
+            }
         });
         
         return renderedForm;